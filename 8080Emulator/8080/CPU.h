@@ -1,8 +1,11 @@
 #pragma once
+#include <array>
+#include <bit>
 #include <cstdint>
 
 enum class Registers8080;
 enum class RegisterPairs8080;
+enum class Condition8080;
 class i8080Emulator;
 
 class CPU
@@ -16,20 +19,34 @@ public:
 	void PrintRegister() const;
 
 private:
+	//sets S, Z and P from the result of an operation
 	void UpdateFlags(const uint8_t& value);
+	//AC is the carry out of bit 3 of lhs + rhs = result
+	void UpdateAuxCarry(uint8_t lhs, uint8_t rhs, uint16_t result);
+	//in lazy flags mode S, Z, P and AC are only built from the last ALU operation when they're read
+	//call this before reading them directly from flags
+	void ResolveFlags() const;
+
+	uint8_t Carry() const { return flags & flag_c; }
+	void SetCarry(bool carry) { flags = uint8_t((flags & ~flag_c) | carry); }
+	bool AuxCarry() const { return flags & flag_ac; }
 
 	uint8_t ReadFlags() const;
 	void SetFlags(uint8_t);
 
-	uint16_t ReadRegisterPair(RegisterPairs8080 pair) const;
-	void SetRegisterPair(RegisterPairs8080 pair, uint16_t value);
-	void SetRegisterPair(RegisterPairs8080 pair, uint8_t LSByte, uint8_t MSByte);
-
-	uint8_t ReadRegister(Registers8080 reg) const;
-	void SetRegister(Registers8080 pair, uint8_t value);
+	//register access resolved at compile time, used by the opcode handlers
+	template<Registers8080 Reg>
+	uint8_t& Register();
+	template<RegisterPairs8080 Pair>
+	uint16_t ReadRegisterPair() const;
+	template<RegisterPairs8080 Pair>
+	void SetRegisterPair(uint16_t value);
+	template<Condition8080 Cond>
+	bool TestCondition() const;
 
-	RegisterPairs8080 GetRegisterPairFromOpcode(uint8_t opcode) const;
-	Registers8080 GetRegisterFromOpcode(uint8_t opcode, uint8_t shift = 0) const;
+	static constexpr RegisterPairs8080 GetRegisterPairFromOpcode(uint8_t opcode);
+	static constexpr Registers8080 GetRegisterFromOpcode(uint8_t opcode, uint8_t shift = 0);
+	static constexpr Condition8080 GetConditionFromOpcode(uint8_t opcode);
 
 private:
 	friend class i8080Emulator;
@@ -51,45 +68,80 @@ private:
 
 	// Status
 	uint8_t interruptsEnabled{};
-	bool halt{};
+	bool halt{}; //stops the batch loop, either HLT or the emulation was stopped
+	bool waitingForInterrupt{}; //HLT with interrupts enabled, an accepted interrupt resumes execution
 	uint64_t clockCount{};
 
-	//primary accumulator
-	uint8_t a{};
-
-	//three 16-bit register pairs (BC, DE, and HL)
-	//that can function as six individual 8-bit registers
-	//the reversed order of the two registers in each register pair is intentional due to the little-endianness
-	//technically this is not very important as I'll only be accessing one byte at a time
-	uint8_t c{};
-	uint8_t b{};
-
-	uint8_t e{};
-	uint8_t d{};
+	//register file
+	//indexed with the 3 bit register field of the opcode (see RegisterIndex)
+	//the two registers in each pair are stored reversed so BC, DE and HL alias as native little-endian words
+	//the slot of the memory reference M is unused
+	union
+	{
+		uint8_t registers[8]{};
+		uint16_t registerPairs[4]; //BC, DE, HL (SP is separate, the last word is A and the unused slot)
+		struct
+		{
+			uint8_t c, b;
+			uint8_t e, d;
+			uint8_t l; //holds the least significant 8 bits
+			uint8_t h; //holds most significant 8 bits
+			uint8_t a; //primary accumulator
+			uint8_t unusedM;
+		};
+	};
+	static_assert(std::endian::native == std::endian::little, "register pairs alias the register file as little-endian words");
 
-	uint8_t l{}; //holds the least significant 8 bits
-	uint8_t h{}; //holds most significant 8 bits
-	//
+	static constexpr int RegisterIndex(Registers8080 reg);
 
 	//stack pointer
 	uint16_t sp{};
 	//program counter
 	uint16_t pc{};
 
-	//file://Resources/8080-Programmers-Manual.pdf ConditionBits p.11 in pdf or p.5 in the book
-	struct
+	//file://Resources/8080-Programmers-Manual.pdf condition bits p.11 in pdf or p.5 in the book
+	//stored packed in the same layout as the PSW byte, so PUSH PSW and POP PSW are plain byte moves
+	//mutable as lazy flags mode fills these in when they're read
+	mutable uint8_t flags{};
+
+	static constexpr uint8_t flag_c	 = 1 << 0; //carry, set if the last addition operation resulted in a carry
+												// or last sub required borrow
+	static constexpr uint8_t flag_p	 = 1 << 2; //parity bit, set if the number of true bits in the result is even
+	static constexpr uint8_t flag_ac = 1 << 4; //auxiliary carry bit for binary coded decimal arithmetic
+	static constexpr uint8_t flag_z	 = 1 << 6; //zero bit, set if the result is zero
+	static constexpr uint8_t flag_s	 = 1 << 7; //sign bit, set if the result is negative
+	static constexpr uint8_t flag_szp = flag_s | flag_z | flag_p;
+	static constexpr uint8_t flag_mask = flag_szp | flag_ac | flag_c;
+
+	//S, Z and P of every possible result
+	static constexpr std::array<uint8_t, 256> szp_table = []
 	{
-		bool c	: 1;  //carry, set if the last addition operation resulted in a carry 
-							// or last sub required borrow
-		bool	: 1;
-		bool p	: 1;  //parity bit, set if the number of true bits in the result is even
-		bool	: 1;
-		bool ac : 1;  //auxiliary carry bit for binary coded decimal arithmetic 
-		bool	: 1;
-		bool z	: 1;  //zero bit, set if the result is zero 
-		bool s	: 1;  //sign bit, set if the result is negative
-	} ConditionBits{};
+		std::array<uint8_t, 256> table{};
+		for (int value = 0; value < 256; ++value) {
+			//find if the parity bit for 8bits (amount of true bits even or odd)
+			uint8_t ones = 0;
+			for (int shift = 0; shift < 8; ++shift)
+				ones += (value >> shift) & 1;
+
+			table[value] = uint8_t((value & flag_s) | (value == 0 ? flag_z : 0) | ((ones & 1) ? 0 : flag_p));
+		}
+		return table;
+	}();
+
+#ifdef I8080_LAZY_FLAGS
+	//Lazy flags
+	//most ALU results are overwritten before anything reads the flags
+	//so only the last result and the operands are stored, BuildFlags turns them into flags
+	//C is still set directly, it's as cheap to compute as it is to store
+	void BuildFlags() const;
+
+	static constexpr uint8_t lazy_szp = 0b01;
+	static constexpr uint8_t lazy_ac = 0b10;
 
+	uint8_t m_LazyResult{};		//S, Z and P are taken from this
+	uint8_t m_LazyAuxCarry{};	//lhs ^ rhs ^ result, AC is bit 4
+	mutable uint8_t m_LazyPending{}; //which flags still have to be built
+#endif
 };
 
 //based 8080-Programmers-Manual page 25
@@ -113,3 +165,107 @@ enum class Registers8080
 	MEM = 0b110, //memory reference M, the addressed location is specified by the HL reg
 	A	= 0b111,
 };
+
+//based 8080-Programmers-Manual, condition field (bits 3-5) of the conditional jump, call and return instructions
+enum class Condition8080
+{
+	NZ = 0b000, //not zero
+	Z  = 0b001, //zero
+	NC = 0b010, //no carry
+	C  = 0b011, //carry
+	PO = 0b100, //parity odd
+	PE = 0b101, //parity even
+	P  = 0b110, //plus
+	M  = 0b111, //minus
+};
+
+constexpr RegisterPairs8080 CPU::GetRegisterPairFromOpcode(const uint8_t opcode)
+{
+	//based 8080-Programmers-Manual page 25
+	return static_cast<RegisterPairs8080>((opcode & 0b00110000) >> 4);
+}
+
+constexpr Registers8080 CPU::GetRegisterFromOpcode(uint8_t opcode, uint8_t shift)
+{
+	//based 8080-Programmers-Manual page 16-17
+	//shift can be specified as some functions like INR DCR MVI use the second 3 bits instead of the first 3
+	return static_cast<Registers8080>((opcode & (0b00000111 << shift)) >> shift);
+}
+
+constexpr Condition8080 CPU::GetConditionFromOpcode(uint8_t opcode)
+{
+	return static_cast<Condition8080>((opcode & 0b00111000) >> 3);
+}
+
+//B C D E H L M A -> 1 0 3 2 5 4 7 6, the swap within each pair makes them little-endian
+constexpr int CPU::RegisterIndex(Registers8080 reg)
+{
+	return static_cast<int>(reg) ^ 1;
+}
+
+template<Registers8080 Reg>
+uint8_t& CPU::Register()
+{
+	static_assert(Reg != Registers8080::MEM, "memory reference M has to go through the emulator");
+
+	return registers[RegisterIndex(Reg)];
+}
+
+template<RegisterPairs8080 Pair>
+uint16_t CPU::ReadRegisterPair() const
+{
+	if constexpr (Pair == RegisterPairs8080::SP) return sp;
+	else return registerPairs[static_cast<int>(Pair)];
+}
+
+template<RegisterPairs8080 Pair>
+void CPU::SetRegisterPair(uint16_t value)
+{
+	if constexpr (Pair == RegisterPairs8080::SP) sp = value;
+	else registerPairs[static_cast<int>(Pair)] = value;
+}
+
+inline void CPU::UpdateFlags(const uint8_t& value)
+{
+#ifdef I8080_LAZY_FLAGS
+	m_LazyResult = value;
+	m_LazyPending |= lazy_szp;
+#else
+	flags = uint8_t((flags & ~flag_szp) | szp_table[value]);
+#endif
+}
+
+inline void CPU::UpdateAuxCarry(uint8_t lhs, uint8_t rhs, uint16_t result)
+{
+#ifdef I8080_LAZY_FLAGS
+	m_LazyAuxCarry = uint8_t(lhs ^ rhs ^ result);
+	m_LazyPending |= lazy_ac;
+#else
+	//AC is bit 4 in the PSW as well, so the carry into bit 4 can be copied over as is
+	flags = uint8_t((flags & ~flag_ac) | ((lhs ^ rhs ^ result) & flag_ac));
+#endif
+}
+
+inline void CPU::ResolveFlags() const
+{
+#ifdef I8080_LAZY_FLAGS
+	if (m_LazyPending)
+		BuildFlags();
+#endif
+}
+
+template<Condition8080 Cond>
+bool CPU::TestCondition() const
+{
+	if constexpr (Cond != Condition8080::NC && Cond != Condition8080::C)
+		ResolveFlags();
+
+	if constexpr (Cond == Condition8080::NZ) return !(flags & flag_z);
+	else if constexpr (Cond == Condition8080::Z) return flags & flag_z;
+	else if constexpr (Cond == Condition8080::NC) return !(flags & flag_c);
+	else if constexpr (Cond == Condition8080::C) return flags & flag_c;
+	else if constexpr (Cond == Condition8080::PO) return !(flags & flag_p);
+	else if constexpr (Cond == Condition8080::PE) return flags & flag_p;
+	else if constexpr (Cond == Condition8080::P) return !(flags & flag_s);
+	else return flags & flag_s;
+}
@@ -1,9 +1,11 @@
 #include "ConsoleWindow.h"
 #include <fcntl.h>
 #include <iomanip>
-#include <comdef.h>
 #include <iostream>
 
+#ifdef _WIN32
+#include <comdef.h>
+
 ConsoleWindow::ConsoleWindow()
 {
 	m_pOutStream = &std::cout;
@@ -66,3 +68,22 @@ void ConsoleWindow::Restore()
 		//SetForegroundWindow(hwnd); //sets it to top
 	}
 }
+
+#else
+//Not on windows, the process already runs in (or without) a terminal
+//so there's no console to allocate or restore
+
+ConsoleWindow::ConsoleWindow()
+{
+	m_pOutStream = &std::cout;
+}
+
+void ConsoleWindow::Clear()
+{
+	std::cout << "\033[2J\033[H" << std::flush;
+}
+
+void ConsoleWindow::Restore()
+{
+}
+#endif
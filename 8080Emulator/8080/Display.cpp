@@ -1,15 +1,18 @@
 #include "Display.h"
+#include <algorithm>
+#include "ScreenRenderer.h"
 #include "i8080Emulator.h"
 
 Display::Display(const char* title, uint16_t width, uint16_t height, uint16_t pixelSize)
-	: m_LastDraw(0)
-	, m_FirstHalf(true)
+	: m_FirstHalf(true)
 {
 	m_PixelSize = pixelSize;
 	m_Width = width;
 	m_Height = height;
 
 	m_Pixels = new uint16_t[m_Width * m_Height];
+	m_MonoPlane = new uint8_t[(m_Width >> 3) * m_Height]{};
+	m_pRenderer = new ScreenRenderer(m_Width, m_Height);
 
 	//m_pMainWindow = SDL_CreateWindow(title, SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, m_Width * pixelSize, m_Height * pixelSize, SDL_WINDOW_SHOWN);
 	//m_pMainRenderer = SDL_CreateRenderer(m_pMainWindow, -1, SDL_RENDERER_ACCELERATED);
@@ -24,43 +27,57 @@ Display::~Display() {
 
 	delete[] m_Pixels;
 	m_Pixels = nullptr;
+
+	delete[] m_MonoPlane;
+	m_MonoPlane = nullptr;
+
+	delete m_pRenderer;
+	m_pRenderer = nullptr;
 }
 
-void Display::Draw(uint8_t* VRAM) const {
+void Display::Draw(const uint8_t* VRAM, uint8_t* VRAMDirty) {
+
+	if (!m_OutputEnabled)
+		return;
+
+	const uint16_t bytesPerColumn = m_Height >> 3; //the pixels are saved in 8 bit integers
+	uint32_t dirtyBytes = 0;
+	uint32_t dirtyBlocks = 0;
 
 	for (uint16_t x = 0; x < m_Width; x++) {
-		for (uint16_t y = 0; y < m_Height; y += 8) { //the pixels are saved in 8 bit integers
+		uint8_t* dirty = VRAMDirty + x * bytesPerColumn;
 
-			uint8_t VRAMByte = VRAM[x * (m_Height >> 3) + (y >> 3)];
+		uint16_t dirtyInColumn = 0;
+		for (uint16_t i = 0; i < bytesPerColumn; i++)
+			dirtyInColumn += dirty[i] != 0;
 
-			for (uint8_t bit = 0; bit < 8; bit++) {
+		if (dirtyInColumn == 0)
+			continue;
 
-				uint16_t colorToDraw = black;
+		std::fill_n(dirty, bytesPerColumn, 0);
+		dirtyBytes += dirtyInColumn;
+		dirtyBlocks |= 1u << (x / ScreenRenderer::block_width);
+	}
 
-				//if the bit is 1 theres a pixel we need to color
-				if (((VRAMByte >> bit) & 1)) {
+	if (m_FullRedraw) {
+		dirtyBlocks = ~0u;
+		m_FullRedraw = false;
+	}
 
-					//(just a small detail =D ) these are some checks to give certain pixels on the screen a color
-					//this is to recreate the display color overlays that were often used in old arcade machines
-					//https://youtu.be/QyjyWUrHsFc?t=95
-					if (y <= 60) {
-						colorToDraw = green;
+	m_DirtyBytes = dirtyBytes;
+	m_TotalDirtyBytes += dirtyBytes;
 
-						if ((x <= 16 || x >= m_Width - 122) && y <= 15) //white text at the bottom for the credits and lives
-							colorToDraw = white;
-					}
-					else if (y >= m_Height - 64 && y <= m_Height - 33)
-						colorToDraw = red;
-					else
-						colorToDraw = white;
-				}
+	//nothing changed, the last published frame is still up to date
+	if (dirtyBlocks == 0)
+		return;
 
-				const uint16_t coordX = x;
-				const uint16_t coordY = static_cast<uint16_t>(m_Height - 1 - (y + bit));
-				m_Pixels[coordY * m_Width + coordX] = colorToDraw;
-			}
-		}
-	}
+	//whole blocks of columns are converted at once
+	if (m_Presentation == Presentation::Mono)
+		m_pRenderer->RenderMono(VRAM, m_MonoPlane, dirtyBlocks);
+	else
+		m_pRenderer->Render(VRAM, m_Pixels, dirtyBlocks);
+
+	++m_FrameId;
 
 	//SDL_UpdateTexture(m_pMainTexture, nullptr, m_Pixels, 2 * m_Width);
 	//SDL_RenderCopy(m_pMainRenderer, m_pMainTexture, nullptr, nullptr);
@@ -72,19 +89,34 @@ void Display::Draw(uint8_t* VRAM) const {
 	}
 }
 
-void Display::Update(uint64_t currTime, uint8_t* VRAM, i8080Emulator* i8080) {
+void Display::SetPresentation(Presentation presentation)
+{
+	if (presentation != m_Presentation)
+		m_FullRedraw = true;
 
-	if (currTime - m_LastDraw > draw_frequency) {
-		m_LastDraw = currTime;
+	m_Presentation = presentation;
+}
 
-		if (m_FirstHalf) {
-			Draw(VRAM);
-			i8080->Interrupt(FirstHalf);
-		}
-		else
-			i8080->Interrupt(SecondHalf);
+uint16_t Display::GetMonoBytesPerLine() const
+{
+	return m_pRenderer->GetMonoBytesPerLine();
+}
+
+void Display::HalfFrame(const uint8_t* VRAM, uint8_t* VRAMDirty, i8080Emulator* i8080) {
 
-		m_FirstHalf = !m_FirstHalf;
+	if (m_FirstHalf) {
+		if (m_FramesSinceDraw < m_FrameSkip) {
+			++m_FramesSinceDraw;
+			++m_SkippedFrames;
+		}
+		else {
+			m_FramesSinceDraw = 0;
+			Draw(VRAM, VRAMDirty);
+		}
+		i8080->Interrupt(FirstHalf);
 	}
+	else
+		i8080->Interrupt(SecondHalf);
 
+	m_FirstHalf = !m_FirstHalf;
 }
@@ -1,8 +1,10 @@
 #pragma once
+#include <cstdint>
 #include <functional>
 #include <utility>
 
 class i8080Emulator;
+class ScreenRenderer;
 
 class Display
 {
@@ -10,35 +12,73 @@ public:
 	Display(const char* title, uint16_t width, uint16_t height, uint16_t pixelSize);
 	~Display();
 
-	void Update(uint64_t currTime, uint8_t* VRAM, i8080Emulator* i8080);
+	//Mid screen or VBlank, draws and/or interrupts depending on which half of the screen was just finished
+	//called by the emulator at exact cycle positions, see Scheduler
+	//VRAMDirty has a byte for every VRAM byte, only columns with a dirty byte are converted and then cleared
+	void HalfFrame(const uint8_t* VRAM, uint8_t* VRAMDirty, i8080Emulator* i8080);
+	//converts the dirty VRAM right away, without an interrupt or frame skipping
+	void Draw(const uint8_t* VRAM, uint8_t* VRAMDirty);
+	//RGB444: m_Pixels is filled with 16 bit colours (112 KiB)
+	//Mono: only the rotated 1 bit per pixel plane is filled (7 KiB), the overlay colours are applied by the presenter
+	enum class Presentation : uint8_t { RGB444, Mono };
+	void SetPresentation(Presentation presentation);
+	Presentation GetPresentation() const { return m_Presentation; }
+
 	void* GetPixels() const{ return m_Pixels; }
+	uint8_t* GetMonoPlane() const { return m_MonoPlane; }
+	uint16_t GetMonoBytesPerLine() const;
 	uint16_t GetHeight() const { return m_Height; }
 	uint16_t GetWidth() const { return m_Width; }
 	uint16_t GetPixelSize() const { return m_PixelSize; }
+	//amount of VRAM bytes that were written to before the last draw
+	uint32_t GetDirtyByteCount() const { return m_DirtyBytes; }
+	uint64_t GetTotalDirtyByteCount() const { return m_TotalDirtyBytes; }
+	ScreenRenderer* GetRenderer() const { return m_pRenderer; }
 
+	//called when a new frame was published, only when something on screen changed
+	//it runs on the emulation side, so it should only schedule the presentation (no painting in here)
 	//https://stackoverflow.com/questions/51705967/advantages-of-pass-by-value-and-stdmove-over-pass-by-reference
 	void AddDrawCallback(std::function<void()> func) { m_DrawCallback = std::move(func); }
+	//increases every time a new frame is published
+	uint64_t GetFrameId() const { return m_FrameId; }
+
+	//while nobody can see the output (hidden or minimized window) nothing is converted
+	//the dirty VRAM keeps accumulating and is converted once it's enabled again
+	void SetOutputEnabled(bool enabled) { m_OutputEnabled = enabled; }
+	bool GetOutputEnabled() const { return m_OutputEnabled; }
+
+	//Frame skipping, for running faster than the host can present
+	//only every (frames + 1)th frame is converted, the emulation itself (interrupts, timing) is unaffected
+	//skipped frames keep their dirty VRAM so the next converted frame is complete
+	void SetFrameSkip(uint32_t frames) { m_FrameSkip = frames; }
+	uint32_t GetFrameSkip() const { return m_FrameSkip; }
+	uint64_t GetSkippedFrameCount() const { return m_SkippedFrames; }
 
 	enum ScreenHalfs { FirstHalf = 0, SecondHalf = 1 };
+	//which half the next HalfFrame finishes, for save states
+	bool IsFirstHalf() const { return m_FirstHalf; }
+	void SetFirstHalf(bool firstHalf) { m_FirstHalf = firstHalf; }
 
 private:
-	void Draw(uint8_t* VRAM) const;
-
 	uint16_t m_Width;
 	uint16_t m_Height;
 	uint16_t m_PixelSize;
 	uint16_t* m_Pixels;
+	uint8_t* m_MonoPlane;
+	Presentation m_Presentation{ Presentation::RGB444 };
+	bool m_FullRedraw{ true }; //after switching presentations the other buffer is out of date
+	bool m_OutputEnabled{ true };
+	uint64_t m_FrameId{};
+	uint32_t m_FrameSkip{};
+	uint32_t m_FramesSinceDraw{};
+	uint64_t m_SkippedFrames{};
+	ScreenRenderer* m_pRenderer;
 
-	uint64_t m_LastDraw;
 	bool m_FirstHalf;
 
-	std::function<void()> m_DrawCallback{nullptr};
-
-	static constexpr uint64_t draw_frequency{ 1'000'000 / 144 }; //144 Hz (Half screen in a cycle, then end screen in another)
+	uint32_t m_DirtyBytes{};
+	uint64_t m_TotalDirtyBytes{};
 
-	static constexpr uint16_t black = 0xf000;
-	static constexpr uint16_t white = 0xffff;
-	static constexpr uint16_t green = 0xf0f0;
-	static constexpr uint16_t red	= 0xff00;
+	std::function<void()> m_DrawCallback{nullptr};
 };
 
@@ -0,0 +1,432 @@
+#include "EmulationThread.h"
+#include <chrono>
+#include <iostream>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "FramePacer.h"
+#include "Keyboard.h"
+#include "Movie.h"
+#include "RewindBuffer.h"
+#include "StateWriter.h"
+#include "i8080Emulator.h"
+
+namespace
+{
+	EmulationThread::Frame MakeEmptyFrame(const Display* display)
+	{
+		//sized for the bigger presentation, so switching never allocates on the emulation thread
+		EmulationThread::Frame frame{};
+		frame.data.resize(size_t(display->GetWidth()) * display->GetHeight() * sizeof(uint16_t));
+		return frame;
+	}
+}
+
+EmulationThread::EmulationThread(i8080Emulator* emulator)
+	: m_pEmulator(emulator)
+	, m_pDisplay(emulator->GetDisplay())
+	, m_pStateWriter(new StateWriter())
+	, m_pRewind(new RewindBuffer())
+	, m_pRecorder(new MovieRecorder(emulator))
+	, m_pPlayer(new MoviePlayer(emulator))
+	, m_pMovie(new Movie())
+	, m_Frames(MakeEmptyFrame(emulator->GetDisplay()))
+{
+}
+
+EmulationThread::~EmulationThread()
+{
+	Stop();
+
+	delete m_pStateWriter; //finishes the writes that are still queued
+	m_pStateWriter = nullptr;
+
+	delete m_pRewind;
+	m_pRewind = nullptr;
+
+	delete m_pRecorder;
+	m_pRecorder = nullptr;
+	delete m_pPlayer;
+	m_pPlayer = nullptr;
+	delete m_pMovie;
+	m_pMovie = nullptr;
+}
+
+void EmulationThread::Start()
+{
+	if (m_Thread.joinable())
+		return;
+
+	m_PauseRequested = false;
+	m_StopRequested = false;
+	m_State = State::Running;
+	m_Thread = std::thread(&EmulationThread::Run, this);
+}
+
+bool EmulationThread::Pause()
+{
+	if (!m_Thread.joinable())
+		return false;
+
+	std::unique_lock lock(m_Mutex);
+	const bool wasRunning = !m_PauseRequested;
+	m_PauseRequested = true;
+	m_StateChanged.notify_all(); //in case it's idle
+	m_StateChanged.wait(lock, [this] { return m_State == State::Paused; });
+
+	return wasRunning;
+}
+
+void EmulationThread::Resume()
+{
+	{
+		std::lock_guard lock(m_Mutex);
+		m_PauseRequested = false;
+	}
+	m_StateChanged.notify_all();
+}
+
+void EmulationThread::Stop()
+{
+	if (!m_Thread.joinable())
+		return;
+
+	{
+		std::lock_guard lock(m_Mutex);
+		m_StopRequested = true;
+	}
+	m_StateChanged.notify_all();
+
+	m_Thread.join();
+	m_State = State::Stopped;
+}
+
+bool EmulationThread::LoadRom(bool consoleProgram, const char* path)
+{
+	const bool wasRunning = Pause();
+	m_pRecorder->Stop();
+	m_pPlayer->Stop();
+	const bool success = m_pEmulator->LoadRom(consoleProgram, path);
+	m_RomPath = success ? path : "";
+	m_pRewind->Clear();
+	m_CapturedFrame = 0;
+	if (wasRunning)
+		Resume();
+
+	return success;
+}
+
+bool EmulationThread::LoadState(int slot)
+{
+	std::vector<uint8_t> state;
+	if (m_RomPath.empty() || !StateWriter::Read(GetStatePath(slot).c_str(), state))
+		return false;
+
+	const bool wasRunning = Pause();
+	//the movie can't follow a jump to another state, a recording is finished and written
+	SetRecording(false);
+	m_pPlayer->Stop();
+	const bool success = m_pEmulator->LoadState(state);
+	if (success)
+	{
+		m_pRewind->Clear();
+		m_CapturedFrame = m_pEmulator->GetFrameCount();
+	}
+	if (wasRunning)
+		Resume();
+
+	return success;
+}
+
+std::string EmulationThread::GetStatePath(int slot) const
+{
+	return m_RomPath + ".state" + std::to_string(slot);
+}
+
+bool EmulationThread::PlayMovie()
+{
+	if (m_RomPath.empty())
+		return false;
+
+	const bool wasRunning = Pause();
+	//a movie that's still being recorded is finished and played from its start
+	SetRecording(false);
+	m_pStateWriter->Flush();
+
+	m_pPlayer->Stop();
+	std::vector<uint8_t> data;
+	const bool success = StateWriter::Read(GetMoviePath().c_str(), data) && m_pMovie->Read(data) && m_pPlayer->Start(m_pMovie);
+	if (success)
+	{
+		m_pRewind->Clear();
+		m_CapturedFrame = m_pEmulator->GetFrameCount();
+		m_Rewinding = false;
+	}
+	if (wasRunning)
+		Resume();
+
+	return success;
+}
+
+std::string EmulationThread::GetMoviePath() const
+{
+	return m_RomPath + ".movie";
+}
+
+bool EmulationThread::Send(Command::Type type, int64_t value)
+{
+	if (!m_Commands.Push({ type, value }))
+		return false;
+
+	//pairs with the fence in WaitUntilRunnable, either the thread sees the command or this sees it's idle
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (m_State.load(std::memory_order_relaxed) == State::Idle)
+		Wake();
+
+	return true;
+}
+
+void EmulationThread::Wake()
+{
+	{
+		std::lock_guard lock(m_Mutex);
+	}
+	m_StateChanged.notify_all();
+}
+
+const EmulationThread::Frame& EmulationThread::AcquireFrame()
+{
+	m_Frames.Acquire();
+	return m_Frames.GetReadBuffer();
+}
+
+void EmulationThread::Run()
+{
+	ApplySchedulingOptions();
+
+	while (WaitUntilRunnable())
+	{
+		ProcessCommands();
+		if (m_Rewinding)
+		{
+			StepBack();
+			continue;
+		}
+
+		m_pEmulator->Update();
+		if (m_AutoFrameSkip)
+			m_pDisplay->SetFrameSkip(m_pEmulator->GetPacer()->GetSuggestedFrameSkip());
+		UpdateMovie();
+		CaptureRewind();
+		PublishFrame();
+	}
+}
+
+void EmulationThread::CaptureRewind()
+{
+	const uint64_t frame = m_pEmulator->GetFrameCount();
+	if (frame == m_CapturedFrame || m_pEmulator->IsConsoleProgram())
+		return;
+
+	m_pRewind->Capture(*m_pEmulator);
+	m_CapturedFrame = frame;
+}
+
+void EmulationThread::SetRecording(bool recording)
+{
+	if (recording == m_pRecorder->IsRecording() || m_RomPath.empty())
+		return;
+
+	if (recording)
+	{
+		m_pPlayer->Stop();
+		m_pRecorder->Start();
+		m_Rewinding = false; //the movie only goes forward
+		return;
+	}
+
+	m_pRecorder->Stop();
+	std::vector<uint8_t> data;
+	m_pRecorder->GetMovie().Write(data);
+	m_pStateWriter->Write(GetMoviePath(), std::move(data));
+}
+
+void EmulationThread::UpdateMovie()
+{
+	m_pRecorder->OnBatchEnd();
+
+	if (!m_pPlayer->IsPlaying())
+		return;
+
+	if (!m_pPlayer->OnBatchEnd())
+	{
+		std::cerr << "Movie replay went out of sync at frame " << m_pPlayer->GetDesyncFrame() << '\n';
+		m_pPlayer->Stop();
+	}
+	else if (m_pPlayer->IsFinished())
+		m_pPlayer->Stop();
+}
+
+void EmulationThread::StepBack()
+{
+	if (m_pRewind->Rewind(*m_pEmulator, 1))
+	{
+		m_CapturedFrame = m_pEmulator->GetFrameCount();
+		m_pEmulator->RedrawDisplay();
+		PublishFrame();
+	}
+
+	//the emulator isn't paced while rewinding, LoadState resyncs the pacer for when it continues
+	std::this_thread::sleep_for(std::chrono::nanoseconds(std::chrono::seconds(1)) / FramePacer::presentation_rate);
+}
+
+bool EmulationThread::WaitUntilRunnable()
+{
+	if (!m_PauseRequested.load(std::memory_order_acquire) && !m_StopRequested.load(std::memory_order_acquire) && !m_pEmulator->IsHalted())
+		return true;
+
+	std::unique_lock lock(m_Mutex);
+	while (!m_StopRequested)
+	{
+		if (!m_PauseRequested)
+		{
+			//keeps the inputs and settings up to date while there's nothing to run
+			ProcessCommands();
+			if (!m_pEmulator->IsHalted())
+			{
+				m_State = State::Running;
+				//the time spent in here doesn't have to be caught up
+				m_pEmulator->GetPacer()->Resync(m_pEmulator->GetClockCount());
+				return true;
+			}
+		}
+
+		m_State = m_PauseRequested ? State::Paused : State::Idle;
+		m_StateChanged.notify_all();
+
+		//pairs with the fence in Send
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		const bool paused = m_PauseRequested;
+		m_StateChanged.wait(lock, [this, paused]
+		{
+			return m_StopRequested || m_PauseRequested != paused || (!paused && !m_Commands.IsEmpty());
+		});
+	}
+
+	return false;
+}
+
+void EmulationThread::ApplySchedulingOptions() const
+{
+#ifdef __linux__
+	if (m_SchedulingOptions.cpu >= 0)
+	{
+		cpu_set_t cpus;
+		CPU_ZERO(&cpus);
+		CPU_SET(m_SchedulingOptions.cpu, &cpus);
+		if (pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) != 0)
+			std::cerr << "Couldn't pin the emulation thread to CPU " << m_SchedulingOptions.cpu << '\n';
+	}
+
+	if (m_SchedulingOptions.realtimePriority)
+	{
+		sched_param param{};
+		param.sched_priority = sched_get_priority_min(SCHED_FIFO);
+		if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) != 0)
+			std::cerr << "Couldn't give the emulation thread real-time priority (needs CAP_SYS_NICE)" << '\n';
+	}
+#else
+	if (m_SchedulingOptions.cpu >= 0 || m_SchedulingOptions.realtimePriority)
+		std::cerr << "Emulation thread affinity and priority are only supported on Linux" << '\n';
+#endif
+}
+
+void EmulationThread::ProcessCommands()
+{
+	Command command;
+	while (m_Commands.Pop(command))
+	{
+		switch (command.type)
+		{
+		case Command::Type::KeyDown:
+			m_pEmulator->GetKeyboard()->KeyDown(int(command.value));
+			break;
+		case Command::Type::KeyUp:
+			m_pEmulator->GetKeyboard()->KeyUp(int(command.value));
+			break;
+		case Command::Type::SetClockSpeed:
+			m_pEmulator->SetClockSpeed(uint64_t(command.value));
+			break;
+		case Command::Type::SetSpeedMode:
+			m_pEmulator->GetPacer()->SetMode(FramePacer::Mode(command.value));
+			break;
+		case Command::Type::SetSpeedMultiplier:
+			m_pEmulator->GetPacer()->SetMultiplier(uint32_t(command.value));
+			break;
+		case Command::Type::SetFrameSkip:
+			m_AutoFrameSkip = command.value == frame_skip_auto;
+			m_pDisplay->SetFrameSkip(m_AutoFrameSkip ? 0 : uint32_t(command.value));
+			break;
+		case Command::Type::SaveState:
+		{
+			if (m_RomPath.empty())
+				break;
+
+			std::vector<uint8_t> state;
+			m_pEmulator->SaveState(state);
+			m_pStateWriter->Write(GetStatePath(int(command.value)), std::move(state));
+			break;
+		}
+		case Command::Type::SetRewinding:
+			//the movie's inputs only go forward
+			m_Rewinding = command.value != 0 && !m_pRecorder->IsRecording() && !m_pPlayer->IsPlaying();
+			break;
+		case Command::Type::SetRecording:
+			SetRecording(command.value != 0);
+			break;
+		case Command::Type::SetPresentation:
+			m_pDisplay->SetPresentation(Display::Presentation(command.value));
+			break;
+		case Command::Type::SetOutputEnabled:
+			m_pDisplay->SetOutputEnabled(command.value != 0);
+			break;
+		case Command::Type::SetIdleSkipping:
+			m_pEmulator->SetIdleSkipping(command.value != 0);
+			break;
+		}
+	}
+}
+
+void EmulationThread::PublishFrame()
+{
+	const uint64_t frameId = m_pDisplay->GetFrameId();
+	if (frameId == m_PublishedFrameId)
+		return;
+
+	Frame& frame = m_Frames.GetWriteBuffer();
+	frame.id = frameId;
+	frame.presentation = m_pDisplay->GetPresentation();
+
+	const uint8_t* source;
+	size_t size;
+	if (frame.presentation == Display::Presentation::Mono)
+	{
+		source = m_pDisplay->GetMonoPlane();
+		size = size_t(m_pDisplay->GetMonoBytesPerLine()) * m_pDisplay->GetHeight();
+	}
+	else
+	{
+		source = static_cast<const uint8_t*>(m_pDisplay->GetPixels());
+		size = size_t(m_pDisplay->GetWidth()) * m_pDisplay->GetHeight() * sizeof(uint16_t);
+	}
+	frame.data.assign(source, source + size);
+
+	m_Frames.Publish();
+	m_PublishedFrameId = frameId;
+
+	if (m_FrameCallback)
+		m_FrameCallback();
+}
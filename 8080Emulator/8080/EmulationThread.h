@@ -0,0 +1,172 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "Display.h"
+#include "SpscQueue.h"
+#include "TripleBuffer.h"
+
+struct Movie;
+class MoviePlayer;
+class MovieRecorder;
+class RewindBuffer;
+class StateWriter;
+class i8080Emulator;
+
+//Runs an emulator on its own thread
+//the front-end never touches the emulator while it's running:
+//finished frames come out of a triple buffer and input/config changes go in through a command queue
+//both are lock-free, the mutex is only used to start, pause and stop the thread
+//the thread blocks instead of spinning while it's paused or there's nothing to run (no ROM or the program ended)
+//and the emulator's FramePacer waits for the wall clock in between batches
+//every ROM frame is captured into a RewindBuffer, while rewinding the thread steps back a frame per presentation instead
+//input movies (see Movie.h) are recorded and replayed on the thread as well, rewinding is ignored while one runs
+class EmulationThread
+{
+public:
+	enum class State : uint8_t
+	{
+		Stopped,
+		Running,
+		Paused,
+		Idle,	//nothing to run, waits for a ROM to be loaded
+	};
+
+	//everything the front-end can change while the emulation is running
+	struct Command
+	{
+		enum class Type : uint8_t
+		{
+			KeyDown,
+			KeyUp,
+			SetClockSpeed,		//Hz
+			SetSpeedMode,		//FramePacer::Mode
+			SetSpeedMultiplier,
+			SetFrameSkip,		//frames, or frame_skip_auto
+			SaveState,			//slot, written to disk in the background (see GetStatePath)
+			SetRewinding,		//bool, steps back through the rewind history while set
+			SetRecording,		//bool, the movie is written to GetMoviePath in the background when it stops
+			SetPresentation,
+			SetOutputEnabled,
+			SetIdleSkipping,
+		};
+
+		Type type;
+		int64_t value;
+	};
+
+	//a finished frame, in the layout of the presentation it was drawn with (see Display)
+	struct Frame
+	{
+		uint64_t id{}; //Display::GetFrameId, 0 until the first frame
+		Display::Presentation presentation{};
+		std::vector<uint8_t> data;
+	};
+
+	//follows FramePacer::GetSuggestedFrameSkip, so turbo only presents about as many frames as the host can show
+	static constexpr int64_t frame_skip_auto = -1;
+
+	//Linux only, applied when the thread starts
+	struct SchedulingOptions
+	{
+		int cpu{ -1 };					//pin the thread to this CPU, -1 to let the OS pick
+		bool realtimePriority{ false };	//SCHED_FIFO, needs CAP_SYS_NICE or a matching rtprio limit
+	};
+
+	//no ownership, the emulator has to outlive this
+	EmulationThread(i8080Emulator* emulator);
+	~EmulationThread();
+
+	EmulationThread(const EmulationThread& other) = delete;
+	EmulationThread(EmulationThread&& other) noexcept = delete;
+	EmulationThread& operator=(const EmulationThread& other) = delete;
+	EmulationThread& operator=(EmulationThread&& other) noexcept = delete;
+
+	//Lifecycle, only called from the thread that owns this
+	void Start();
+	//blocks until the emulation thread is parked, the emulator can then be used directly
+	//returns true if it was running before
+	bool Pause();
+	void Resume();
+	//blocks until the thread has exited
+	void Stop();
+	State GetState() const { return m_State.load(std::memory_order_acquire); }
+
+	void SetSchedulingOptions(const SchedulingOptions& options) { m_SchedulingOptions = options; }
+
+	//these pause around the load if it's running and start a new rewind history
+	bool LoadRom(bool consoleProgram, const char* path);
+	//reads the slot's file, a movie that's being recorded or replayed is stopped first
+	bool LoadState(int slot);
+	//next to the ROM, <rom>.state<slot>
+	std::string GetStatePath(int slot) const;
+	//reads the ROM's movie and replays it from its start, stops recording first
+	bool PlayMovie();
+	//next to the ROM, <rom>.movie
+	std::string GetMoviePath() const;
+
+	//false if the queue is full, it's drained before every batch
+	bool Send(Command::Type type, int64_t value);
+
+	//called on the emulation thread after a frame was published, should only schedule the presentation
+	//https://stackoverflow.com/questions/51705967/advantages-of-pass-by-value-and-stdmove-over-pass-by-reference
+	void SetFrameCallback(std::function<void()> func) { m_FrameCallback = std::move(func); }
+	//newest published frame, stays valid until the next call
+	const Frame& AcquireFrame();
+
+private:
+	void Run();
+	void ApplySchedulingOptions() const;
+	//blocks while paused or idle, false once the thread should exit
+	bool WaitUntilRunnable();
+	//wakes the thread if it's idle
+	void Wake();
+	void ProcessCommands();
+	void PublishFrame();
+	//captures a rewind snapshot if a frame ended since the last one
+	void CaptureRewind();
+	//loads the previous rewind snapshot and shows it, then waits a presentation interval
+	void StepBack();
+	void SetRecording(bool recording);
+	//records or checks the frame, ends a replay that's done
+	void UpdateMovie();
+
+	static constexpr size_t command_queue_size = 256;
+
+	//no ownership
+	i8080Emulator* m_pEmulator;
+	Display* m_pDisplay;
+
+	StateWriter* m_pStateWriter;
+	std::string m_RomPath; //only changed while the thread is paused
+
+	RewindBuffer* m_pRewind;
+	uint64_t m_CapturedFrame{};
+	bool m_Rewinding{ false };
+
+	MovieRecorder* m_pRecorder;
+	MoviePlayer* m_pPlayer;
+	Movie* m_pMovie; //the one being replayed
+
+	std::thread m_Thread;
+	std::mutex m_Mutex;
+	std::condition_variable m_StateChanged;
+	std::atomic<State> m_State{ State::Stopped };
+	//checked before every batch without taking the mutex
+	std::atomic<bool> m_PauseRequested{ false };
+	std::atomic<bool> m_StopRequested{ false };
+	SchedulingOptions m_SchedulingOptions{};
+	bool m_AutoFrameSkip{ false };
+
+	SpscQueue<Command, command_queue_size> m_Commands;
+	TripleBuffer<Frame> m_Frames;
+	uint64_t m_PublishedFrameId{};
+	std::function<void()> m_FrameCallback{};
+};
@@ -0,0 +1,154 @@
+#include "FramePacer.h"
+#include <algorithm>
+#include <thread>
+
+using namespace std::chrono;
+
+namespace
+{
+	//split so cycles * 1e9 can't overflow on long runs
+	nanoseconds CyclesToTime(uint64_t cycles, uint64_t rate)
+	{
+		const uint64_t seconds = cycles / rate;
+		const uint64_t remainder = cycles % rate;
+		return nanoseconds(seconds * 1'000'000'000 + remainder * 1'000'000'000 / rate);
+	}
+}
+
+void FramePacer::Reset(uint64_t cycle)
+{
+	m_Stats = {};
+	m_Dropped = {};
+	Resync(cycle);
+}
+
+void FramePacer::Resync(uint64_t cycle)
+{
+	m_Start = Clock::now();
+	m_StartCycle = cycle;
+	m_NeedsResync = false;
+	m_LastFrameTime = {}; //the time in between isn't a frame
+}
+
+void FramePacer::Pace(uint64_t cycle, uint64_t frame)
+{
+	const uint64_t rate = GetEffectiveRate();
+	Clock::time_point now = Clock::now();
+
+	//nothing to wait for, leaving turbo starts the timeline from wherever it got to
+	if (rate == 0)
+	{
+		m_NeedsResync = true;
+		RecordFrame(now, frame);
+		return;
+	}
+
+	//LoadRom starts the clock over, so a clock that went backwards resyncs as well
+	if (m_NeedsResync || cycle < m_StartCycle)
+	{
+		Resync(cycle);
+		m_LastFrame = frame;
+		return;
+	}
+
+	const Clock::time_point deadline = m_Start + CyclesToTime(cycle - m_StartCycle, rate);
+
+	if (now < deadline)
+	{
+		if (deadline - now > spin_margin)
+			std::this_thread::sleep_until(deadline - spin_margin);
+		while ((now = Clock::now()) < deadline)
+			;
+
+		const nanoseconds jitter = now - deadline;
+		++m_Stats.waits;
+		m_Stats.totalJitter += jitter;
+		m_Stats.maxJitter = std::max(m_Stats.maxJitter, jitter);
+		m_Stats.drift = m_Dropped + jitter;
+	}
+	else
+	{
+		//behind, no waiting until it caught up
+		nanoseconds lag = now - deadline;
+		++m_Stats.lateWaits;
+
+		if (lag > max_lag)
+		{
+			//too far behind to catch up, give the time up
+			++m_Stats.resyncs;
+			m_Dropped += lag;
+			m_Start = now;
+			m_StartCycle = cycle;
+			lag = {};
+		}
+		m_Stats.drift = m_Dropped + lag;
+	}
+
+	RecordFrame(now, frame);
+}
+
+void FramePacer::SetMode(Mode mode)
+{
+	m_Mode = mode;
+	m_NeedsResync = true;
+}
+
+void FramePacer::SetMultiplier(uint32_t multiplier)
+{
+	m_Multiplier = std::max<uint32_t>(multiplier, 1);
+	m_NeedsResync = true;
+}
+
+void FramePacer::SetClockRate(uint64_t hz)
+{
+	m_ClockRate = std::max<uint64_t>(hz, 1);
+	m_NeedsResync = true;
+}
+
+uint64_t FramePacer::GetEffectiveRate() const
+{
+	switch (m_Mode)
+	{
+	case Mode::Turbo:
+		return 0;
+	case Mode::Multiplier:
+		return m_ClockRate * m_Multiplier;
+	case Mode::RealTime:
+	default:
+		return m_ClockRate;
+	}
+}
+
+uint32_t FramePacer::GetSuggestedFrameSkip() const
+{
+	if (m_RecentFrameTime.count() == 0)
+		return 0;
+
+	//rounded, so real time jitter doesn't flip between skipping and not
+	constexpr nanoseconds presentation_interval = duration_cast<nanoseconds>(seconds(1)) / presentation_rate;
+	const int64_t framesPerPresentation = (presentation_interval + m_RecentFrameTime / 2) / m_RecentFrameTime;
+	return uint32_t(std::clamp<int64_t>(framesPerPresentation - 1, 0, max_frame_skip));
+}
+
+void FramePacer::RecordFrame(Clock::time_point now, uint64_t frame)
+{
+	if (frame == m_LastFrame)
+		return;
+
+	if (m_LastFrameTime != Clock::time_point{} && frame > m_LastFrame)
+	{
+		//more than one frame can end in between two pacing points in turbo
+		const uint64_t frames = frame - m_LastFrame;
+		const nanoseconds interval = now - m_LastFrameTime;
+		const nanoseconds perFrame = interval / int64_t(frames);
+
+		m_Stats.frames += frames;
+		m_Stats.totalFrameTime += interval;
+		m_Stats.minFrameTime = std::min(m_Stats.minFrameTime, perFrame);
+		m_Stats.maxFrameTime = std::max(m_Stats.maxFrameTime, perFrame);
+		m_RecentFrameTime = m_RecentFrameTime.count() ? (m_RecentFrameTime * 7 + perFrame) / 8 : perFrame;
+	}
+
+	m_LastFrame = frame;
+	m_LastFrameTime = now;
+}
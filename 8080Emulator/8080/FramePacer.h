@@ -0,0 +1,103 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+
+//Keeps the emulated clock in step with the wall clock
+//every emulated cycle has an absolute deadline (start of the timeline + cycles / clock rate)
+//so rounding and oversleeping never add up, Pace waits for the deadline of the current cycle:
+//it sleeps until shortly before it and spins the rest, the OS scheduler tends to wake up late
+//when the host falls behind it runs without waiting until it caught up,
+//more than max_lag behind the timeline is started over and the time is given up (a resync)
+class FramePacer
+{
+public:
+	enum class Mode : uint8_t
+	{
+		RealTime,	//the clock rate
+		Turbo,		//no waiting at all
+		Multiplier,	//N times the clock rate
+	};
+
+	struct Stats
+	{
+		uint64_t waits{};		//Pace calls that had to wait
+		uint64_t lateWaits{};	//Pace calls that were already past the deadline
+		uint64_t resyncs{};		//times the timeline was started over after falling behind
+		//how late the waits woke up
+		std::chrono::nanoseconds totalJitter{};
+		std::chrono::nanoseconds maxJitter{};
+		//wall clock time minus emulated time since Reset, positive is behind, includes resyncs
+		std::chrono::nanoseconds drift{};
+
+		//frame intervals as seen at the pacing points
+		uint64_t frames{};
+		std::chrono::nanoseconds totalFrameTime{};
+		std::chrono::nanoseconds minFrameTime{ std::chrono::nanoseconds::max() };
+		std::chrono::nanoseconds maxFrameTime{};
+
+		std::chrono::nanoseconds MeanJitter() const { return waits ? totalJitter / int64_t(waits) : std::chrono::nanoseconds{}; }
+		double GetFps() const { return totalFrameTime.count() ? frames * 1e9 / totalFrameTime.count() : 0.0; }
+	};
+
+	static constexpr uint64_t default_clock_rate = 2'000'000; //Hz
+	static constexpr uint32_t presentation_rate = 60; //Hz
+	static constexpr uint32_t max_frame_skip = 60;
+
+	FramePacer() = default;
+
+	//starts a new timeline at cycle, call after the emulated clock was reset
+	void Reset(uint64_t cycle);
+	//starts the timeline over at cycle without counting a resync, after a pause or a settings change
+	void Resync(uint64_t cycle);
+
+	//waits until cycle is due, frame is the emulated frame count (for the stats only)
+	void Pace(uint64_t cycle, uint64_t frame);
+
+	void SetMode(Mode mode);
+	Mode GetMode() const { return m_Mode; }
+	void SetMultiplier(uint32_t multiplier);
+	uint32_t GetMultiplier() const { return m_Multiplier; }
+	//clock cycles per second in real time
+	void SetClockRate(uint64_t hz);
+	uint64_t GetClockRate() const { return m_ClockRate; }
+
+	//frames to skip so about presentation_rate frames per second have to be presented, from the recent frame times
+	uint32_t GetSuggestedFrameSkip() const;
+
+	const Stats& GetStats() const { return m_Stats; }
+	void ResetStats() { m_Stats = {}; }
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	//emulated clock cycles per second in the current mode, 0 in turbo
+	uint64_t GetEffectiveRate() const;
+	void RecordFrame(Clock::time_point now, uint64_t frame);
+
+	//the last stretch before a deadline is spun, sleeping is only accurate to the OS timer resolution
+#ifdef _WIN32
+	static constexpr std::chrono::microseconds spin_margin{ 2000 };
+#else
+	static constexpr std::chrono::microseconds spin_margin{ 500 };
+#endif
+	static constexpr std::chrono::milliseconds max_lag{ 100 };
+
+	Mode m_Mode{ Mode::RealTime };
+	uint32_t m_Multiplier{ 2 };
+	uint64_t m_ClockRate{ default_clock_rate };
+
+	//the timeline, m_Start is when m_StartCycle is due
+	Clock::time_point m_Start{};
+	uint64_t m_StartCycle{};
+	bool m_NeedsResync{ true };
+
+	//time given up by resyncs since Reset
+	std::chrono::nanoseconds m_Dropped{};
+
+	uint64_t m_LastFrame{};
+	Clock::time_point m_LastFrameTime{};
+	//moving average of the last few frame times, for the turbo frame skip
+	std::chrono::nanoseconds m_RecentFrameTime{};
+
+	Stats m_Stats{};
+};
@@ -0,0 +1,18 @@
+#include "InterruptController.h"
+#include <bit>
+#include <cassert>
+
+void InterruptController::Request(uint8_t rst)
+{
+	assert(rst < 8);
+	m_Pending |= uint8_t(1 << rst);
+}
+
+uint8_t InterruptController::Acknowledge()
+{
+	assert(HasPending());
+
+	const uint8_t rst = static_cast<uint8_t>(std::countr_zero(m_Pending));
+	m_Pending &= uint8_t(m_Pending - 1); //clear lowest set bit
+	return rst;
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include <cstdint>
+
+//Latches interrupt requests until the CPU accepts them
+//on the Space Invaders board a device puts an RST instruction on the data bus, the request
+//stays pending while interrupts are disabled instead of being lost
+class InterruptController
+{
+public:
+	void Reset() { m_Pending = 0; }
+
+	//rst is the RST number (0-7), the CPU jumps to rst * 8 when it's accepted
+	void Request(uint8_t rst);
+	bool HasPending() const { return m_Pending != 0; }
+
+	//clears and returns the pending request with the lowest RST number
+	uint8_t Acknowledge();
+
+	//bit per RST number, for save states
+	uint8_t GetPending() const { return m_Pending; }
+	void SetPending(uint8_t pending) { m_Pending = pending; }
+
+private:
+	uint8_t m_Pending{}; //one bit per RST number
+};
@@ -13,15 +13,13 @@ public:
     void KeyUp(int key);
     void KeyDown(int key);
 
-	void Update(uint64_t currTime);
+	//writes the current key states to the input ports, called once per frame by the emulator
+	void Poll();
 
 private:
-	uint64_t m_LastInput;
 	CPU* m_pCPUref;
 
     std::map<int, bool> m_KeyboardState;
-
-	static constexpr uint64_t update_frequency{ 1'000'000 / 30 }; //30hz
 };
 
 
@@ -0,0 +1,198 @@
+#include "MachinePool.h"
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+#include "Display.h"
+#include "i8080Emulator.h"
+
+using namespace std::chrono;
+
+MachinePool::MachinePool(unsigned threads, uint64_t quantumCycles)
+	: m_QuantumCycles(std::max<uint64_t>(quantumCycles, 1))
+{
+	threads = threads != 0 ? threads : std::max(std::thread::hardware_concurrency(), 1u);
+	for (unsigned i = 0; i < threads; ++i)
+		m_Queues.push_back(new WorkerQueue());
+}
+
+MachinePool::~MachinePool()
+{
+	for (Machine* machine : m_Machines)
+	{
+		delete machine->emulator;
+		delete machine;
+	}
+	for (WorkerQueue* queue : m_Queues)
+		delete queue;
+}
+
+bool MachinePool::Add(const char* romPath, bool consoleProgram, Limit limit)
+{
+	i8080Emulator* emulator = new i8080Emulator();
+	if (!emulator->LoadRom(consoleProgram, romPath))
+	{
+		delete emulator;
+		return false;
+	}
+
+	Add(emulator, limit);
+	return true;
+}
+
+void MachinePool::Add(i8080Emulator* emulator, Limit limit)
+{
+	emulator->GetDisplay()->SetOutputEnabled(false);
+
+	Machine* machine = new Machine{};
+	machine->emulator = emulator;
+	machine->limit = limit;
+	m_Machines.push_back(machine);
+}
+
+void MachinePool::Run()
+{
+	m_Stats = {};
+	m_Stats.threads = unsigned(m_Queues.size());
+
+	//dealt out round robin, the stealing evens out whatever that gets wrong
+	size_t remaining = 0;
+	for (size_t i = 0; i < m_Machines.size(); ++i)
+	{
+		Machine& machine = *m_Machines[i];
+		if (machine.done)
+			continue;
+
+		machine.stats = {};
+		machine.startCycles = machine.emulator->GetClockCount();
+		machine.startInstructions = machine.emulator->GetInstructionCount();
+		machine.startFrames = machine.emulator->GetFrameCount();
+		machine.lastWorker = unsigned(remaining % m_Queues.size());
+
+		WorkerQueue& queue = *m_Queues[machine.lastWorker];
+		queue.machines.push_back(i);
+		queue.seconds = 0;
+		queue.steals = 0;
+		++remaining;
+	}
+	m_Remaining = remaining;
+
+	const auto start = steady_clock::now();
+
+	std::vector<std::thread> threads;
+	for (unsigned i = 1; i < m_Queues.size(); ++i)
+		threads.emplace_back(&MachinePool::Work, this, i);
+	Work(0);
+	for (std::thread& thread : threads)
+		thread.join();
+
+	m_Stats.seconds = duration<double>(steady_clock::now() - start).count();
+	for (const WorkerQueue* queue : m_Queues)
+	{
+		m_Stats.workerSeconds.push_back(queue->seconds);
+		m_Stats.steals += queue->steals;
+	}
+	for (const Machine* machine : m_Machines)
+	{
+		m_Stats.cycles += machine->stats.cycles;
+		m_Stats.instructions += machine->stats.instructions;
+		m_Stats.frames += machine->stats.frames;
+		m_Stats.quanta += machine->stats.quanta;
+	}
+}
+
+void MachinePool::Work(unsigned worker)
+{
+	WorkerQueue& queue = *m_Queues[worker];
+
+	while (m_Remaining.load(std::memory_order_acquire) > 0)
+	{
+		//every machine left is running on another worker, which keeps it until it's done
+		//the queues can't get new machines anymore, so there's nothing left to do here
+		size_t index;
+		if (!Take(worker, index))
+			return;
+
+		Machine& machine = *m_Machines[index];
+		if (machine.lastWorker != worker)
+			++machine.stats.migrations;
+		machine.lastWorker = worker;
+
+		const auto start = steady_clock::now();
+		const bool done = RunQuantum(machine);
+		const double seconds = duration<double>(steady_clock::now() - start).count();
+		machine.stats.seconds += seconds;
+		queue.seconds += seconds;
+
+		if (done)
+		{
+			machine.done = true;
+			m_Remaining.fetch_sub(1, std::memory_order_release);
+		}
+		else
+		{
+			std::lock_guard lock(queue.mutex);
+			queue.machines.push_back(index);
+		}
+	}
+}
+
+bool MachinePool::Take(unsigned worker, size_t& machine)
+{
+	{
+		WorkerQueue& own = *m_Queues[worker];
+		std::lock_guard lock(own.mutex);
+		if (!own.machines.empty())
+		{
+			machine = own.machines.front();
+			own.machines.pop_front();
+			return true;
+		}
+	}
+
+	for (size_t i = 1; i < m_Queues.size(); ++i)
+	{
+		WorkerQueue& victim = *m_Queues[(worker + i) % m_Queues.size()];
+		std::lock_guard lock(victim.mutex);
+		if (!victim.machines.empty())
+		{
+			machine = victim.machines.front();
+			victim.machines.pop_front();
+			++m_Queues[worker]->steals;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool MachinePool::RunQuantum(Machine& machine) const
+{
+	i8080Emulator& emulator = *machine.emulator;
+	const Limit& limit = machine.limit;
+	MachineStats& stats = machine.stats;
+
+	uint64_t quantum = m_QuantumCycles;
+	if (limit.cycles != 0)
+		quantum = std::min(quantum, limit.cycles - stats.cycles);
+
+	if (limit.frames != 0)
+	{
+		//whole frames so the run ends exactly at the frame limit
+		const uint64_t end = emulator.GetClockCount() + quantum;
+		while (emulator.GetClockCount() < end && emulator.GetFrameCount() - machine.startFrames < limit.frames && !emulator.IsHalted())
+			emulator.RunFrame();
+	}
+	else
+		emulator.RunCycles(quantum);
+
+	stats.cycles = emulator.GetClockCount() - machine.startCycles;
+	stats.instructions = emulator.GetInstructionCount() - machine.startInstructions;
+	stats.frames = emulator.GetFrameCount() - machine.startFrames;
+	stats.halted = emulator.IsHalted();
+	++stats.quanta;
+
+	return stats.halted
+		|| (limit.cycles != 0 && stats.cycles >= limit.cycles)
+		|| (limit.frames != 0 && stats.frames >= limit.frames);
+}
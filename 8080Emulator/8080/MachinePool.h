@@ -0,0 +1,113 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+class i8080Emulator;
+
+//Runs many independent emulators at once on a fixed set of worker threads
+//every machine runs in quanta of emulated cycles, a worker takes the machine at the front of its queue, runs a quantum
+//and puts it at the back, so the machines of a worker take turns
+//a worker whose queue ran dry steals the machine at the front of another worker's queue (the one that waited the longest),
+//so machines that stop early (a test that fails at once) don't leave the other threads idle
+//a machine only ever runs on one thread at a time, it can move between threads in between quanta
+class MachinePool
+{
+public:
+	//when a machine is done, whatever comes first, 0 for no limit
+	//a machine without limits runs until it halts (console programs that exit)
+	struct Limit
+	{
+		uint64_t frames{};
+		uint64_t cycles{};
+	};
+
+	struct MachineStats
+	{
+		uint64_t cycles{};
+		uint64_t instructions{};
+		uint64_t frames{};
+		uint64_t quanta{};
+		uint64_t migrations{}; //quanta that ran on a different worker than the one before
+		double seconds{}; //time spent running it, not counting the time it waited in a queue
+		bool halted{};
+	};
+
+	struct Stats
+	{
+		double seconds{}; //wall clock time of the whole Run
+		uint64_t cycles{};
+		uint64_t instructions{};
+		uint64_t frames{};
+		uint64_t quanta{};
+		uint64_t steals{};
+		unsigned threads{};
+		std::vector<double> workerSeconds; //time every worker spent running machines
+	};
+
+	//4 frames of a 2 MHz machine, long enough that taking a machine from a queue costs nothing next to running it
+	static constexpr uint64_t default_quantum_cycles = 4 * 2'000'000 / 60;
+
+	//threads 0 uses every hardware thread
+	MachinePool(unsigned threads = 0, uint64_t quantumCycles = default_quantum_cycles);
+	~MachinePool();
+
+	MachinePool(const MachinePool& other) = delete;
+	MachinePool(MachinePool&& other) noexcept = delete;
+	MachinePool& operator=(const MachinePool& other) = delete;
+	MachinePool& operator=(MachinePool&& other) noexcept = delete;
+
+	//loads a new machine, false if the ROM couldn't be loaded
+	//its display output is disabled, the VRAM is still there
+	bool Add(const char* romPath, bool consoleProgram, Limit limit);
+	//takes ownership, for machines that were set up already (a Clone of another machine shares its pages)
+	void Add(i8080Emulator* emulator, Limit limit);
+	//to set a machine up (LoadState, SetIdleSkipping, SetInputHook, ...) before Run or to read its results after it
+	i8080Emulator* GetMachine(size_t index) const { return m_Machines[index]->emulator; }
+	size_t GetMachineCount() const { return m_Machines.size(); }
+
+	//blocks until every machine reached its limit or halted, the calling thread is one of the workers
+	//machines that are already done are skipped, so Add and Run again runs only the new ones
+	void Run();
+
+	const MachineStats& GetMachineStats(size_t index) const { return m_Machines[index]->stats; }
+	const Stats& GetStats() const { return m_Stats; }
+
+private:
+	//only touched by the worker running it, a cache line of its own so two workers never share one
+	struct alignas(64) Machine
+	{
+		i8080Emulator* emulator;
+		Limit limit;
+		MachineStats stats;
+		uint64_t startCycles;
+		uint64_t startInstructions;
+		uint64_t startFrames;
+		unsigned lastWorker;
+		bool done;
+	};
+
+	//a quantum is far longer than the lock is held, so the lock is never contended for long
+	struct alignas(64) WorkerQueue
+	{
+		std::mutex mutex;
+		std::deque<size_t> machines;
+		double seconds{};
+		uint64_t steals{};
+	};
+
+	void Work(unsigned worker);
+	bool Take(unsigned worker, size_t& machine);
+	//runs one quantum, true once the machine is done
+	bool RunQuantum(Machine& machine) const;
+
+	std::vector<Machine*> m_Machines;
+	std::vector<WorkerQueue*> m_Queues;
+	uint64_t m_QuantumCycles;
+
+	alignas(64) std::atomic<size_t> m_Remaining{};
+	Stats m_Stats{};
+};
@@ -0,0 +1,225 @@
+#include "Memory.h"
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cstring>
+
+//the storage isn't initialized, pages are only read from it once they were copied in (see Unshare)
+Memory::Memory()
+	: m_Storage(new uint8_t[address_space])
+	, m_Dirty(new uint8_t[address_space])
+{
+	Reset();
+}
+
+Memory::~Memory()
+{
+	for (SharedPage*& page : m_SharedPages) {
+		if (page != nullptr)
+			Release(page);
+		page = nullptr;
+	}
+
+	delete[] m_Storage;
+	m_Storage = nullptr;
+
+	delete[] m_Dirty;
+	m_Dirty = nullptr;
+}
+
+void Memory::Reset()
+{
+	SharedPage* zero = ZeroPage();
+	for (SharedPage*& page : m_SharedPages) {
+		if (page != nullptr)
+			Release(page);
+		zero->references.fetch_add(1, std::memory_order_relaxed);
+		page = zero;
+	}
+	m_WriteFaultCount = 0;
+	m_CopiedPageCount = 0;
+
+	Map(0, address_space, 0, Ram);
+}
+
+void Memory::Share(Memory& other)
+{
+	assert(&other != this);
+
+	for (uint32_t storagePage = 0; storagePage < page_count; ++storagePage) {
+		SharedPage* page = ZeroPage(); //not reachable through the map, only there to keep every page readable
+		if (other.m_MappedStorage & (uint64_t(1) << storagePage))
+			page = other.m_SharedPages[storagePage] != nullptr ? other.m_SharedPages[storagePage] : other.Publish(storagePage);
+
+		page->references.fetch_add(1, std::memory_order_relaxed);
+		if (m_SharedPages[storagePage] != nullptr)
+			Release(m_SharedPages[storagePage]);
+		m_SharedPages[storagePage] = page;
+	}
+
+	std::copy_n(other.m_Targets, page_count, m_Targets);
+	std::copy_n(other.m_Attributes, page_count, m_Attributes);
+	m_WritableStorage = other.m_WritableStorage;
+	m_MappedStorage = other.m_MappedStorage;
+	m_VramStorage = other.m_VramStorage;
+	m_WriteFaultCount = 0;
+	m_CopiedPageCount = 0;
+
+	for (uint32_t page = 0; page < page_count; ++page) {
+		m_DirtyPages[page] = (m_Attributes[page] & Vram) ? m_Dirty + (m_Targets[page] << page_shift) : m_DirtySink;
+		UpdatePage(page);
+	}
+	MarkAllDirty();
+}
+
+void Memory::Map(uint16_t start, uint32_t size, uint16_t target, uint8_t attributes)
+{
+	assert((start & page_mask) == 0 && (size & page_mask) == 0 && (target & page_mask) == 0);
+	assert(start + size <= address_space && target + size <= address_space);
+
+	for (uint32_t offset = 0; offset < size; offset += page_size) {
+		const uint32_t page = (start + offset) >> page_shift;
+
+		m_Targets[page] = uint8_t((target + offset) >> page_shift);
+		m_DirtyPages[page] = (attributes & Vram) ? m_Dirty + target + offset : m_DirtySink;
+		m_Attributes[page] = attributes;
+		UpdatePage(page);
+	}
+
+	//a page can be remapped, so check everything again
+	m_WritableStorage = 0;
+	m_MappedStorage = 0;
+	m_VramStorage = 0;
+	for (uint32_t page = 0; page < page_count; ++page) {
+		const uint64_t storageBit = uint64_t(1) << m_Targets[page];
+		m_MappedStorage |= storageBit;
+		if (m_Attributes[page] & (Ram | Vram))
+			m_WritableStorage |= storageBit;
+		if (m_Attributes[page] & Vram)
+			m_VramStorage |= storageBit;
+	}
+
+	//newly mapped VRAM has to be drawn
+	if (attributes & Vram)
+		std::fill_n(m_Dirty + target, size, 1);
+}
+
+void Memory::SetWatch(uint16_t start, uint32_t size, bool watch)
+{
+	assert(start + size <= address_space);
+
+	for (uint32_t page = start >> page_shift; page < (start + size + page_mask) >> page_shift; ++page) {
+		m_Attributes[page] = watch ? (m_Attributes[page] | Watch) : (m_Attributes[page] & ~Watch);
+		UpdatePage(page);
+	}
+}
+
+uint8_t* Memory::GetStorage(uint32_t start, uint32_t size)
+{
+	assert(start + size <= address_space);
+
+	for (uint32_t storagePage = start >> page_shift; storagePage < (start + size + page_mask) >> page_shift; ++storagePage) {
+		if (m_SharedPages[storagePage] != nullptr)
+			Unshare(storagePage);
+	}
+	return m_Storage + start;
+}
+
+const uint8_t* Memory::GetStoragePage(uint32_t page) const
+{
+	return m_SharedPages[page] != nullptr ? m_SharedPages[page]->data : m_Storage + (page << page_shift);
+}
+
+uint64_t Memory::GetSharedStoragePages() const
+{
+	uint64_t pages = 0;
+	for (uint32_t page = 0; page < page_count; ++page) {
+		if (m_SharedPages[page] != nullptr)
+			pages |= uint64_t(1) << page;
+	}
+	return pages;
+}
+
+//only the dirty map of VRAM is ever read, the rest of it isn't even initialized
+void Memory::MarkAllDirty()
+{
+	for (uint64_t pages = m_VramStorage; pages != 0; pages &= pages - 1)
+		std::fill_n(m_Dirty + (std::countr_zero(pages) << page_shift), page_size, 1);
+}
+
+Memory::SharedPage* Memory::ZeroPage()
+{
+	//the reference it starts with is never released
+	static SharedPage zero{ 1, {} };
+	return &zero;
+}
+
+void Memory::Release(SharedPage* page)
+{
+	if (page->references.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+		assert(page != ZeroPage());
+		delete page;
+	}
+}
+
+void Memory::UpdatePage(uint32_t page)
+{
+	const uint32_t storagePage = m_Targets[page];
+	SharedPage* shared = m_SharedPages[storagePage];
+	m_ReadPages[page] = shared != nullptr ? shared->data : m_Storage + (storagePage << page_shift);
+
+	const bool directWrite = !(m_Attributes[page] & (Rom | Watch)) && shared == nullptr;
+	m_WritePages[page] = directWrite ? m_ReadPages[page] : nullptr;
+}
+
+void Memory::UpdateStoragePage(uint32_t storagePage)
+{
+	for (uint32_t page = 0; page < page_count; ++page) {
+		if (m_Targets[page] == storagePage)
+			UpdatePage(page);
+	}
+}
+
+Memory::SharedPage* Memory::Publish(uint32_t storagePage)
+{
+	assert(m_SharedPages[storagePage] == nullptr);
+
+	SharedPage* page = new SharedPage{ 1, {} };
+	std::memcpy(page->data, m_Storage + (storagePage << page_shift), page_size);
+	m_SharedPages[storagePage] = page;
+	UpdateStoragePage(storagePage);
+	return page;
+}
+
+void Memory::Unshare(uint32_t storagePage)
+{
+	SharedPage* page = m_SharedPages[storagePage];
+	assert(page != nullptr);
+
+	std::memcpy(m_Storage + (storagePage << page_shift), page->data, page_size);
+	m_SharedPages[storagePage] = nullptr;
+	Release(page);
+	UpdateStoragePage(storagePage);
+	++m_CopiedPageCount;
+}
+
+//cold path, ROM writes are dropped like on the real hardware, watched writes still happen
+//the first write to a shared page copies it
+void Memory::WriteFault(uint16_t address, uint8_t data)
+{
+	const uint32_t page = address >> page_shift;
+	const uint8_t attributes = m_Attributes[page];
+
+	if (attributes & Rom)
+		++m_WriteFaultCount;
+	else {
+		if (m_SharedPages[m_Targets[page]] != nullptr)
+			Unshare(m_Targets[page]);
+
+		m_ReadPages[page][address & page_mask] = data;
+		m_DirtyPages[page][address & page_mask] = 1;
+	}
+
+	if ((attributes & (Rom | Watch)) && m_FaultCallback != nullptr)
+		m_FaultCallback(address, data, attributes);
+}
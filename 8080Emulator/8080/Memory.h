@@ -0,0 +1,131 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <utility>
+
+//Page table memory map
+//every 1 KiB page of the 64 KiB address space points into the backing storage and has attribute bits
+//reads are always a single indexed load, writes to pages that can't be written directly (ROM, watched)
+//have no write pointer and go to the cold fault handler instead
+//every write also marks the byte in the dirty map of its page, pages that aren't VRAM all share a
+//scratch page for this so the write path doesn't need a branch
+//
+//storage pages are copy-on-write, a page is either private (in the contiguous storage) or a refcounted page
+//that's shared with clones (see Share), shared pages have no write pointer either so the first write
+//goes through the fault handler, which copies the page into the private storage
+//fresh storage shares a single zero page, so memory is only touched once it's written to
+class Memory
+{
+public:
+	enum Attributes : uint8_t
+	{
+		Rom		= 1 << 0,
+		Ram		= 1 << 1,
+		Vram	= 1 << 2, //writes are tracked in the dirty map
+		Mirror	= 1 << 3, //maps onto storage of another address range
+		Watch	= 1 << 4, //writes are still done but reported to the fault callback
+	};
+
+	static constexpr uint32_t address_space = 0x10000;
+	static constexpr int page_shift = 10;
+	static constexpr uint32_t page_size = 1 << page_shift;
+	static constexpr uint32_t page_count = address_space >> page_shift;
+	static constexpr uint16_t page_mask = page_size - 1;
+
+	//address, data and the attributes of the page that was written to
+	using FaultCallback = std::function<void(uint16_t address, uint8_t data, uint8_t attributes)>;
+
+	Memory();
+	~Memory();
+
+	Memory(const Memory& other) = delete;
+	Memory(Memory&& other) noexcept = delete;
+	Memory& operator=(const Memory& other) = delete;
+	Memory& operator=(Memory&& other) noexcept = delete;
+
+	//zeroes the storage and maps the whole address space as plain RAM
+	void Reset();
+	//turns this into a copy of other, mapping included, every storage page mapped in other is shared with it
+	//a shared page is copied by whichever memory writes to it first, pages that are only read (ROM) stay shared
+	//other's private pages become shared as well, the fault callback isn't copied
+	void Share(Memory& other);
+
+	//maps [start, start + size) onto storage starting at target, start and size have to be page aligned
+	void Map(uint16_t start, uint32_t size, uint16_t target, uint8_t attributes);
+	void SetWatch(uint16_t start, uint32_t size, bool watch);
+
+	uint8_t Read(uint16_t address) const { return m_ReadPages[address >> page_shift][address & page_mask]; }
+	void Write(uint16_t address, uint8_t data)
+	{
+		uint8_t* page = m_WritePages[address >> page_shift];
+		if (page != nullptr) [[likely]] {
+			page[address & page_mask] = data;
+			m_DirtyPages[address >> page_shift][address & page_mask] = 1;
+		}
+		else
+			WriteFault(address, data);
+	}
+
+	uint8_t GetAttributes(uint16_t address) const { return m_Attributes[address >> page_shift]; }
+	//bit per page of storage that's mapped as RAM or VRAM somewhere, everything else never changes
+	uint64_t GetWritableStoragePages() const { return m_WritableStorage; }
+	static_assert(page_count <= 64, "one bit per page");
+
+	//the backing storage of [start, start + size), unmapped and contiguous (used to load roms and by the display)
+	//shared pages in the range are copied first so they can be written to, ask for as little as possible
+	uint8_t* GetStorage(uint32_t start, uint32_t size);
+	//one page of storage to read from, shared or not
+	const uint8_t* GetStoragePage(uint32_t page) const;
+	//storage pages that are shared right now, bit per page
+	uint64_t GetSharedStoragePages() const;
+	//shared pages that had to be copied because they were written to
+	uint64_t GetCopiedPageCount() const { return m_CopiedPageCount; }
+	//one byte per byte of storage, non zero if it was written since the last clear, only kept for VRAM
+	uint8_t* GetDirty() const { return m_Dirty; }
+	//marks all of VRAM dirty, for when the storage is changed without going through Write
+	void MarkAllDirty();
+
+	void AddFaultCallback(FaultCallback func) { m_FaultCallback = std::move(func); }
+	uint64_t GetWriteFaultCount() const { return m_WriteFaultCount; }
+
+private:
+	//a storage page of one or more memories, immutable while it's shared
+	struct SharedPage
+	{
+		std::atomic<uint32_t> references;
+		uint8_t data[page_size];
+	};
+
+	//all zeros, never freed
+	static SharedPage* ZeroPage();
+	static void Release(SharedPage* page);
+
+	void UpdatePage(uint32_t page);
+	//updates every page that's mapped onto the storage page
+	void UpdateStoragePage(uint32_t storagePage);
+	//the storage page becomes a shared page, the first one to write to it copies it again
+	SharedPage* Publish(uint32_t storagePage);
+	//copies a shared page back into the private storage
+	void Unshare(uint32_t storagePage);
+	void WriteFault(uint16_t address, uint8_t data);
+
+	uint8_t* m_Storage;
+	SharedPage* m_SharedPages[page_count]{}; //nullptr if the storage page is private
+	uint8_t m_Targets[page_count]{}; //storage page every page is mapped onto
+
+	uint8_t* m_ReadPages[page_count]{};
+	uint8_t* m_WritePages[page_count]{}; //nullptr if writes have to go through WriteFault
+	uint8_t* m_DirtyPages[page_count]{};
+
+	uint8_t* m_Dirty;
+	uint8_t m_DirtySink[page_size]{}; //written to but never read
+	uint8_t m_Attributes[page_count]{};
+	uint64_t m_WritableStorage{};
+	uint64_t m_MappedStorage{};
+	uint64_t m_VramStorage{};
+	uint64_t m_CopiedPageCount{};
+
+	FaultCallback m_FaultCallback{ nullptr };
+	uint64_t m_WriteFaultCount{};
+};
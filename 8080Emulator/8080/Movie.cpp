@@ -0,0 +1,375 @@
+#include "Movie.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <iostream>
+
+#include "Keyboard.h"
+#include "i8080Emulator.h"
+
+namespace
+{
+	void WriteVarint(std::vector<uint8_t>& data, uint64_t value)
+	{
+		while (value >= 0x80)
+		{
+			data.push_back(uint8_t(value | 0x80));
+			value >>= 7;
+		}
+		data.push_back(uint8_t(value));
+	}
+
+	//false if it runs past end
+	bool ReadVarint(const uint8_t*& in, const uint8_t* end, uint64_t& value)
+	{
+		value = 0;
+		for (unsigned shift = 0; in < end && shift < 64; shift += 7)
+		{
+			const uint8_t byte = *in++;
+			value |= uint64_t(byte & 0x7F) << shift;
+			if (!(byte & 0x80))
+				return true;
+		}
+		return false;
+	}
+}
+
+void Movie::Write(std::vector<uint8_t>& data) const
+{
+	std::vector<uint8_t> inputData;
+	uint64_t previousCycle = 0;
+	for (const Input& input : inputs)
+	{
+		WriteVarint(inputData, input.cycle - previousCycle);
+		inputData.push_back(input.port);
+		inputData.push_back(input.value);
+		previousCycle = input.cycle;
+	}
+
+	MovieHeader header;
+	std::memset(&header, 0, sizeof(header));
+	header.magic = MovieHeader::magic_value;
+	header.version = MovieHeader::current_version;
+	header.headerSize = sizeof(MovieHeader);
+	header.romHash = romHash;
+	header.startStateSize = startState.size();
+	header.inputCount = inputs.size();
+	header.inputBytes = inputData.size();
+	header.frameCount = frameHashes.size();
+	header.flags = idleSkipping ? MovieHeader::flag_idle_skipping : 0;
+	header.keyframeInterval = keyframeInterval;
+	header.keyframeCount = keyframes.size();
+
+	const size_t keyframeSize = 2 * sizeof(uint64_t) + startState.size();
+	data.resize(sizeof(header) + startState.size() + inputData.size() + frameHashes.size() * sizeof(uint64_t) + keyframes.size() * keyframeSize);
+	uint8_t* out = data.data();
+	std::memcpy(out, &header, sizeof(header));
+	out += sizeof(header);
+	std::memcpy(out, startState.data(), startState.size());
+	out += startState.size();
+	std::memcpy(out, inputData.data(), inputData.size());
+	out += inputData.size();
+	std::memcpy(out, frameHashes.data(), frameHashes.size() * sizeof(uint64_t));
+	out += frameHashes.size() * sizeof(uint64_t);
+
+	for (const Keyframe& keyframe : keyframes)
+	{
+		assert(keyframe.state.size() == startState.size());
+		std::memcpy(out, &keyframe.frame, sizeof(uint64_t));
+		std::memcpy(out + sizeof(uint64_t), &keyframe.inputIndex, sizeof(uint64_t));
+		std::memcpy(out + 2 * sizeof(uint64_t), keyframe.state.data(), keyframe.state.size());
+		out += keyframeSize;
+	}
+}
+
+bool Movie::Read(const uint8_t* data, size_t size)
+{
+	MovieHeader header;
+	if (size < sizeof(header))
+	{
+		std::cerr << "Movie is too small" << '\n';
+		return false;
+	}
+	std::memcpy(&header, data, sizeof(header));
+
+	if (header.magic != MovieHeader::magic_value || header.version != MovieHeader::current_version || header.headerSize != sizeof(header))
+	{
+		std::cerr << "Not a movie or from an unsupported version" << '\n';
+		return false;
+	}
+
+	//every size is checked against what's left before it's multiplied, so a corrupted header can't make this read past the end
+	uint64_t left = size - sizeof(header);
+	const auto take = [&left](uint64_t count, uint64_t elementSize)
+	{
+		if (elementSize != 0 && count > left / elementSize)
+			return false;
+		left -= count * elementSize;
+		return true;
+	};
+	const bool sizesMatch = take(header.startStateSize, 1) && take(header.inputBytes, 1) && take(header.frameCount, sizeof(uint64_t))
+		&& take(header.keyframeCount, 2 * sizeof(uint64_t) + header.startStateSize) && left == 0;
+
+	if (!sizesMatch || (header.keyframeCount != 0 && (header.keyframeInterval == 0 || header.keyframeCount > header.frameCount / header.keyframeInterval)))
+	{
+		std::cerr << "Movie is corrupted" << '\n';
+		return false;
+	}
+
+	const uint8_t* in = data + sizeof(header);
+
+	std::vector<uint8_t> state(in, in + header.startStateSize);
+	in += header.startStateSize;
+
+	std::vector<Input> readInputs;
+	const uint8_t* const inputEnd = in + header.inputBytes;
+	uint64_t cycle = 0;
+	while (in < inputEnd)
+	{
+		uint64_t delta;
+		if (!ReadVarint(in, inputEnd, delta) || inputEnd - in < 2 || in[0] >= 4)
+		{
+			std::cerr << "Movie is corrupted" << '\n';
+			return false;
+		}
+		cycle += delta;
+		readInputs.push_back({ cycle, in[0], in[1] });
+		in += 2;
+	}
+
+	if (readInputs.size() != header.inputCount)
+	{
+		std::cerr << "Movie is corrupted" << '\n';
+		return false;
+	}
+
+	std::vector<uint64_t> hashes(header.frameCount);
+	if (!hashes.empty())
+		std::memcpy(hashes.data(), in, hashes.size() * sizeof(uint64_t));
+	in += hashes.size() * sizeof(uint64_t);
+
+	std::vector<Keyframe> readKeyframes(header.keyframeCount);
+	for (uint64_t i = 0; i < header.keyframeCount; ++i)
+	{
+		Keyframe& keyframe = readKeyframes[i];
+		std::memcpy(&keyframe.frame, in, sizeof(uint64_t));
+		std::memcpy(&keyframe.inputIndex, in + sizeof(uint64_t), sizeof(uint64_t));
+		in += 2 * sizeof(uint64_t);
+		keyframe.state.assign(in, in + header.startStateSize);
+		in += header.startStateSize;
+
+		if (keyframe.frame != (i + 1) * header.keyframeInterval || keyframe.inputIndex > readInputs.size())
+		{
+			std::cerr << "Movie is corrupted" << '\n';
+			return false;
+		}
+	}
+
+	romHash = header.romHash;
+	idleSkipping = (header.flags & MovieHeader::flag_idle_skipping) != 0;
+	startState = std::move(state);
+	inputs = std::move(readInputs);
+	frameHashes = std::move(hashes);
+	keyframeInterval = uint32_t(header.keyframeInterval);
+	keyframes = std::move(readKeyframes);
+	return true;
+}
+
+uint64_t Movie::HashState(const std::vector<uint8_t>& state)
+{
+	uint64_t hash = 0xcbf29ce484222325;
+	size_t i = 0;
+	for (; i + sizeof(uint64_t) <= state.size(); i += sizeof(uint64_t))
+	{
+		uint64_t word;
+		std::memcpy(&word, state.data() + i, sizeof(word));
+		hash = (hash ^ word) * 0x100000001b3;
+	}
+	for (; i < state.size(); ++i)
+		hash = (hash ^ state[i]) * 0x100000001b3;
+
+	return hash;
+}
+
+MovieRecorder::MovieRecorder(i8080Emulator* emulator)
+	: m_pEmulator(emulator)
+{
+}
+
+MovieRecorder::~MovieRecorder()
+{
+	Stop();
+}
+
+void MovieRecorder::Start(uint32_t keyframeInterval)
+{
+	m_Movie = {};
+	m_Movie.keyframeInterval = keyframeInterval;
+	m_Movie.romHash = m_pEmulator->GetRomHash();
+	m_Movie.idleSkipping = m_pEmulator->GetIdleSkipping();
+	m_pEmulator->SaveState(m_Movie.startState);
+
+	m_HasPorts = false;
+	m_StartFrame = m_pEmulator->GetFrameCount();
+	m_LastFrame = m_StartFrame;
+	m_Recording = true;
+	m_pEmulator->SetInputHook([this](uint64_t cycle, uint8_t* inPort) { Poll(cycle, inPort); });
+}
+
+void MovieRecorder::OnBatchEnd()
+{
+	const uint64_t frame = m_pEmulator->GetFrameCount();
+	if (!m_Recording || frame == m_LastFrame)
+		return;
+
+	//a state from before the recording was loaded, the movie can't continue from it
+	if (frame < m_LastFrame)
+	{
+		Stop();
+		return;
+	}
+
+	//a batch that ran over more than one frame leaves the ones in between unchecked (0)
+	m_Movie.frameHashes.resize(frame - m_StartFrame - 1, 0);
+
+	m_pEmulator->SaveState(m_State);
+	m_Movie.frameHashes.push_back(Movie::HashState(m_State));
+	m_LastFrame = frame;
+
+	const uint64_t frames = m_Movie.frameHashes.size();
+	if (m_Movie.keyframeInterval != 0 && frames % m_Movie.keyframeInterval == 0)
+		m_Movie.keyframes.push_back({ frames, m_Movie.inputs.size(), m_State });
+}
+
+void MovieRecorder::Stop()
+{
+	if (!m_Recording)
+		return;
+
+	m_pEmulator->SetInputHook(nullptr);
+	m_Recording = false;
+}
+
+void MovieRecorder::Poll(uint64_t cycle, uint8_t* inPort)
+{
+	m_pEmulator->GetKeyboard()->Poll();
+
+	for (uint8_t port = 0; port < 4; ++port)
+	{
+		if (m_HasPorts && inPort[port] == m_Ports[port])
+			continue;
+
+		m_Movie.inputs.push_back({ cycle, port, inPort[port] });
+		m_Ports[port] = inPort[port];
+	}
+	m_HasPorts = true;
+}
+
+MoviePlayer::MoviePlayer(i8080Emulator* emulator)
+	: m_pEmulator(emulator)
+{
+}
+
+MoviePlayer::~MoviePlayer()
+{
+	Stop();
+}
+
+bool MoviePlayer::Start(const Movie* movie)
+{
+	return Start(movie, 0);
+}
+
+bool MoviePlayer::Start(const Movie* movie, size_t keyframe)
+{
+	Stop();
+
+	if (keyframe > movie->keyframes.size())
+		return false;
+
+	const std::vector<uint8_t>& state = keyframe == 0 ? movie->startState : movie->keyframes[keyframe - 1].state;
+	if (movie->romHash != m_pEmulator->GetRomHash() || !m_pEmulator->LoadState(state))
+	{
+		std::cerr << "Movie is from a different ROM" << '\n';
+		return false;
+	}
+
+	const uint64_t frame = keyframe == 0 ? 0 : movie->keyframes[keyframe - 1].frame;
+	m_pMovie = movie;
+	m_pEmulator->SetIdleSkipping(movie->idleSkipping);
+	m_NextInput = keyframe == 0 ? 0 : size_t(movie->keyframes[keyframe - 1].inputIndex);
+	m_StartFrame = m_pEmulator->GetFrameCount() - frame;
+	m_LastFrame = m_pEmulator->GetFrameCount();
+	m_FramesChecked = frame;
+	m_DesyncFrame = -1;
+	m_Playing = true;
+	m_pEmulator->SetInputHook([this](uint64_t cycle, uint8_t* inPort) { Poll(cycle, inPort); });
+
+	return true;
+}
+
+bool MoviePlayer::Seek(uint64_t frame)
+{
+	if (m_pMovie == nullptr || frame > m_pMovie->frameHashes.size())
+		return false;
+
+	//keyframes are evenly spaced, no search
+	const size_t keyframe = m_pMovie->keyframeInterval == 0 ? 0
+		: size_t(std::min<uint64_t>(frame / m_pMovie->keyframeInterval, m_pMovie->keyframes.size()));
+	if (!Start(m_pMovie, keyframe))
+		return false;
+
+	while (m_FramesChecked < frame && !m_pEmulator->IsHalted())
+	{
+		m_pEmulator->RunFrame();
+		if (!OnBatchEnd())
+			return false;
+	}
+
+	return m_FramesChecked == frame;
+}
+
+bool MoviePlayer::OnBatchEnd()
+{
+	const uint64_t frame = m_pEmulator->GetFrameCount();
+	if (!m_Playing || frame == m_LastFrame)
+		return m_DesyncFrame < 0;
+
+	//a state from before the current frame was loaded, the replay can't continue from it
+	if (frame < m_LastFrame)
+	{
+		Stop();
+		return m_DesyncFrame < 0;
+	}
+	m_LastFrame = frame;
+
+	const uint64_t index = frame - m_StartFrame - 1;
+	if (index >= m_pMovie->frameHashes.size())
+		return m_DesyncFrame < 0;
+	m_FramesChecked = index + 1;
+
+	if (m_pMovie->frameHashes[index] != 0 && m_DesyncFrame < 0)
+	{
+		m_pEmulator->SaveState(m_State);
+		if (Movie::HashState(m_State) != m_pMovie->frameHashes[index])
+			m_DesyncFrame = int64_t(index);
+	}
+
+	return m_DesyncFrame < 0;
+}
+
+void MoviePlayer::Stop()
+{
+	if (!m_Playing)
+		return;
+
+	m_pEmulator->SetInputHook(nullptr);
+	m_Playing = false;
+}
+
+void MoviePlayer::Poll(uint64_t cycle, uint8_t* inPort)
+{
+	const std::vector<Movie::Input>& inputs = m_pMovie->inputs;
+	for (; m_NextInput < inputs.size() && inputs[m_NextInput].cycle <= cycle; ++m_NextInput)
+		inPort[inputs[m_NextInput].port] = inputs[m_NextInput].value;
+}
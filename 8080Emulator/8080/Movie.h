@@ -0,0 +1,173 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+class i8080Emulator;
+
+//Input movies
+//the input ports are the only thing from outside that reaches the program, they're polled at fixed emulated cycles
+//and the interrupts come from the emulated clock as well (see Scheduler)
+//so a movie is a save state to start from plus every change of the ports, stamped with the cycle of the poll
+//replaying those at the same cycles runs the exact same instructions, at any speed
+//a hash of the state after every frame is kept to find the first frame a replay went different (a desync)
+//every keyframeInterval frames the whole state is kept as well (a keyframe),
+//a replay can start at any of them, so seeking is O(1) and the parts in between can be checked in parallel (see MovieVerifier)
+//
+//file layout, in native byte order like save states:
+//MovieHeader, start state, inputs (varint cycles since the previous input, port, value), frame hashes (uint64_t each),
+//keyframes (frame, input index, both uint64_t, and a state the size of the start state)
+struct MovieHeader
+{
+	static constexpr uint32_t magic_value = 0x4D303849; //"I80M"
+	static constexpr uint16_t current_version = 2; //2: keyframes
+	static constexpr uint64_t flag_idle_skipping = 1 << 0;
+
+	uint32_t magic;
+	uint16_t version;
+	uint16_t headerSize;
+	uint64_t romHash;
+	uint64_t startStateSize;
+	uint64_t inputCount;
+	uint64_t inputBytes;
+	uint64_t frameCount;
+	uint64_t flags;	//settings that change the state, the replay uses the recorded ones
+	uint64_t keyframeInterval;
+	uint64_t keyframeCount;
+};
+
+static_assert(std::is_trivially_copyable_v<MovieHeader>);
+static_assert(std::has_unique_object_representations_v<MovieHeader>, "the header can't have padding");
+
+struct Movie
+{
+	struct Input
+	{
+		uint64_t cycle;
+		uint8_t port;
+		uint8_t value;
+	};
+
+	//the state after frame frames of the movie, inputs from inputIndex on haven't been applied yet
+	struct Keyframe
+	{
+		uint64_t frame;
+		uint64_t inputIndex;
+		std::vector<uint8_t> state;
+	};
+
+	//10 seconds, a state is about 20 frames worth of hashes
+	static constexpr uint32_t default_keyframe_interval = 600;
+
+	//data is overwritten
+	void Write(std::vector<uint8_t>& data) const;
+	//false if it's not a movie or it's cut off, the movie is unchanged then
+	bool Read(const uint8_t* data, size_t size);
+	bool Read(const std::vector<uint8_t>& data) { return Read(data.data(), data.size()); }
+
+	//what the frame hashes are made of, FNV-1a over 64 bit words of a save state
+	static uint64_t HashState(const std::vector<uint8_t>& state);
+
+	uint64_t romHash{};
+	bool idleSkipping{ true }; //skipped cycles and instructions are part of the state
+	std::vector<uint8_t> startState;
+	std::vector<Input> inputs;
+	std::vector<uint64_t> frameHashes;
+	uint32_t keyframeInterval{ default_keyframe_interval }; //0 without keyframes
+	std::vector<Keyframe> keyframes; //keyframe n is at frame (n + 1) * keyframeInterval
+};
+
+//Records the input ports of an emulator into a movie
+//it takes over the keyboard poll (see i8080Emulator::SetInputHook), the keyboard is still polled through it
+class MovieRecorder
+{
+public:
+	//no ownership, the emulator has to outlive this
+	MovieRecorder(i8080Emulator* emulator);
+	~MovieRecorder();
+
+	MovieRecorder(const MovieRecorder& other) = delete;
+	MovieRecorder(MovieRecorder&& other) noexcept = delete;
+	MovieRecorder& operator=(const MovieRecorder& other) = delete;
+	MovieRecorder& operator=(MovieRecorder&& other) noexcept = delete;
+
+	//starts a new movie from the emulator's current state, only call in between batches
+	//keyframeInterval is in frames, 0 records none
+	void Start(uint32_t keyframeInterval = Movie::default_keyframe_interval);
+	//hashes the state if a frame ended, call after every batch (Update, RunFrame, ...)
+	//stops the recording if the frame count went back (a state was loaded)
+	void OnBatchEnd();
+	//gives the keyboard poll back, the movie is kept
+	void Stop();
+
+	bool IsRecording() const { return m_Recording; }
+	const Movie& GetMovie() const { return m_Movie; }
+
+private:
+	void Poll(uint64_t cycle, uint8_t* inPort);
+
+	i8080Emulator* m_pEmulator; //no ownership
+	Movie m_Movie{};
+	bool m_Recording{ false };
+
+	uint8_t m_Ports[4]{};
+	bool m_HasPorts{ false }; //the first poll records every port
+	uint64_t m_StartFrame{};
+	uint64_t m_LastFrame{};
+	std::vector<uint8_t> m_State; //scratch for the hashes
+};
+
+//Replays a movie into an emulator and checks every frame against the recorded hashes
+//it can start at the beginning or at any keyframe
+class MoviePlayer
+{
+public:
+	//no ownership, the emulator has to outlive this
+	MoviePlayer(i8080Emulator* emulator);
+	~MoviePlayer();
+
+	MoviePlayer(const MoviePlayer& other) = delete;
+	MoviePlayer(MoviePlayer&& other) noexcept = delete;
+	MoviePlayer& operator=(const MoviePlayer& other) = delete;
+	MoviePlayer& operator=(MoviePlayer&& other) noexcept = delete;
+
+	//no ownership, the movie has to outlive the replay
+	//loads the movie's start state, false if the movie is from a different ROM
+	bool Start(const Movie* movie);
+	//loads keyframe - 1 (0 is the start state), only call in between batches
+	bool Start(const Movie* movie, size_t keyframe);
+	//loads the last keyframe before frame and runs up to it, at most a keyframe interval of frames
+	//false if frame is past the end or the frames in between didn't match
+	bool Seek(uint64_t frame);
+	//checks the state if a frame ended, call after every batch
+	//false once a frame differs from the recording, the replay keeps running
+	//stops the replay if the frame count went back (a state was loaded)
+	bool OnBatchEnd();
+	//gives the keyboard poll back
+	void Stop();
+
+	bool IsPlaying() const { return m_Playing; }
+	//every recorded frame was played
+	bool IsFinished() const { return m_pMovie && m_FramesChecked >= m_pMovie->frameHashes.size(); }
+	//frames of the movie that were played, including the ones before the keyframe it started at
+	uint64_t GetFramesChecked() const { return m_FramesChecked; }
+	uint64_t GetFrameCount() const { return m_pMovie ? m_pMovie->frameHashes.size() : 0; }
+	//first frame of the movie that didn't match, -1 if all did so far
+	int64_t GetDesyncFrame() const { return m_DesyncFrame; }
+
+private:
+	void Poll(uint64_t cycle, uint8_t* inPort);
+
+	//no ownership
+	i8080Emulator* m_pEmulator;
+	const Movie* m_pMovie{ nullptr };
+	bool m_Playing{ false };
+
+	size_t m_NextInput{};
+	uint64_t m_StartFrame{}; //emulator frame count at frame 0 of the movie
+	uint64_t m_LastFrame{};
+	uint64_t m_FramesChecked{};
+	int64_t m_DesyncFrame{ -1 };
+	std::vector<uint8_t> m_State; //scratch for the hashes
+};
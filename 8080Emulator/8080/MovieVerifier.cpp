@@ -0,0 +1,89 @@
+#include "MovieVerifier.h"
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Display.h"
+#include "Movie.h"
+#include "i8080Emulator.h"
+
+MovieVerifier::MovieVerifier(const char* romPath, bool consoleProgram, unsigned threads)
+	: m_RomPath(romPath)
+	, m_ConsoleProgram(consoleProgram)
+	, m_Threads(threads != 0 ? threads : std::max(std::thread::hardware_concurrency(), 1u))
+{
+}
+
+bool MovieVerifier::Verify(const Movie& movie, Result& result) const
+{
+	result = {};
+	result.segments = movie.keyframes.size() + 1;
+	result.threads = unsigned(std::min<size_t>(m_Threads, result.segments));
+
+	//segments are handed out in order, so the early ones finish first and a desync is found early
+	std::atomic<size_t> nextSegment{ 0 };
+	std::atomic<bool> romLoaded{ true };
+	std::mutex resultMutex;
+
+	const auto worker = [&]
+	{
+		//one emulator per thread, reused for every segment it takes
+		i8080Emulator emulator{};
+		if (!emulator.LoadRom(m_ConsoleProgram, m_RomPath.c_str()))
+		{
+			romLoaded = false;
+			return;
+		}
+		emulator.GetDisplay()->SetOutputEnabled(false); //the pixels aren't part of the state
+
+		MoviePlayer player(&emulator);
+		std::vector<uint8_t> state;
+
+		for (size_t segment = nextSegment++; segment < result.segments; segment = nextSegment++)
+		{
+			if (!player.Start(&movie, segment))
+			{
+				romLoaded = false;
+				return;
+			}
+
+			const bool last = segment == movie.keyframes.size();
+			const uint64_t end = last ? movie.frameHashes.size() : movie.keyframes[segment].frame;
+
+			bool inSync = true;
+			while (inSync && player.GetFramesChecked() < end && !emulator.IsHalted())
+			{
+				emulator.RunFrame();
+				inSync = player.OnBatchEnd();
+			}
+
+			//the frame hashes can be left out (0), the next keyframe can't
+			int64_t desyncFrame = player.GetDesyncFrame();
+			if (inSync && player.GetFramesChecked() < end)
+				desyncFrame = int64_t(player.GetFramesChecked()); //halted early
+			else if (inSync && !last)
+			{
+				emulator.SaveState(state);
+				if (state != movie.keyframes[segment].state)
+					desyncFrame = int64_t(end - 1);
+			}
+
+			std::lock_guard lock(resultMutex);
+			result.framesChecked += player.GetFramesChecked() - (segment == 0 ? 0 : movie.keyframes[segment - 1].frame);
+			if (desyncFrame >= 0 && (result.desyncFrame < 0 || desyncFrame < result.desyncFrame))
+				result.desyncFrame = desyncFrame;
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for (unsigned i = 1; i < result.threads; ++i)
+		threads.emplace_back(worker);
+	worker();
+	for (std::thread& thread : threads)
+		thread.join();
+
+	result.inSync = result.desyncFrame < 0;
+	return romLoaded;
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+struct Movie;
+
+//Checks a whole movie on several threads at once
+//the movie is split at its keyframes and every part (a segment) is replayed from its keyframe on its own emulator,
+//every frame has to match the recorded hashes and the segment has to end in the next keyframe's state
+//a movie without keyframes is a single segment, as slow as replaying it
+class MovieVerifier
+{
+public:
+	struct Result
+	{
+		bool inSync{ true };
+		int64_t desyncFrame{ -1 };	//first frame that didn't match
+		uint64_t framesChecked{};
+		size_t segments{};
+		unsigned threads{};
+	};
+
+	//threads 0 uses every hardware thread
+	MovieVerifier(const char* romPath, bool consoleProgram, unsigned threads = 0);
+
+	MovieVerifier(const MovieVerifier& other) = delete;
+	MovieVerifier(MovieVerifier&& other) noexcept = delete;
+	MovieVerifier& operator=(const MovieVerifier& other) = delete;
+	MovieVerifier& operator=(MovieVerifier&& other) noexcept = delete;
+
+	//blocks until every segment was checked, false if the ROM couldn't be loaded
+	bool Verify(const Movie& movie, Result& result) const;
+
+private:
+	std::string m_RomPath;
+	bool m_ConsoleProgram;
+	unsigned m_Threads;
+};
@@ -0,0 +1,288 @@
+#include "RewindBuffer.h"
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cstring>
+#include <iostream>
+
+#include "i8080Emulator.h"
+
+//Snapshot encoding, a list of runs until the end of the state:
+//zero run length (varint), literal length (varint), literal bytes
+//the zero run is skipped and the literal is XOR'd onto the state, trailing zeros aren't stored
+namespace
+{
+	uint8_t* WriteLength(uint8_t* out, size_t length)
+	{
+		while (length >= 0x80)
+		{
+			*out++ = uint8_t(length | 0x80);
+			length >>= 7;
+		}
+		*out++ = uint8_t(length);
+		return out;
+	}
+
+	//nullptr if the length runs past end
+	const uint8_t* ReadLength(const uint8_t* in, const uint8_t* end, size_t& length)
+	{
+		length = 0;
+		for (unsigned shift = 0; in < end && shift < 64; shift += 7)
+		{
+			const uint8_t byte = *in++;
+			length |= size_t(byte & 0x7F) << shift;
+			if (!(byte & 0x80))
+				return in;
+		}
+		return nullptr;
+	}
+
+	template<bool HasBase>
+	uint8_t ByteAt(const uint8_t* state, const uint8_t* base, size_t i)
+	{
+		if constexpr (HasBase)
+			return state[i] ^ base[i];
+		else
+			return state[i];
+	}
+
+	//zero bytes from pos on, a word at a time, most of a delta is zero
+	template<bool HasBase>
+	size_t ZeroRun(const uint8_t* state, const uint8_t* base, size_t pos, size_t size)
+	{
+		const size_t start = pos;
+		for (; pos + sizeof(uint64_t) <= size; pos += sizeof(uint64_t))
+		{
+			uint64_t word;
+			std::memcpy(&word, state + pos, sizeof(word));
+			if constexpr (HasBase)
+			{
+				uint64_t baseWord;
+				std::memcpy(&baseWord, base + pos, sizeof(baseWord));
+				word ^= baseWord;
+			}
+
+			if (word != 0)
+			{
+				const int zeroBits = std::endian::native == std::endian::little ? std::countr_zero(word) : std::countl_zero(word);
+				return pos - start + zeroBits / 8;
+			}
+		}
+
+		while (pos < size && ByteAt<HasBase>(state, base, pos) == 0)
+			++pos;
+		return pos - start;
+	}
+
+	template<bool HasBase>
+	size_t EncodeRuns(const uint8_t* state, const uint8_t* base, size_t size, size_t minZeroRun, uint8_t* out)
+	{
+		uint8_t* const begin = out;
+		size_t pos = 0;
+
+		while (pos < size)
+		{
+			const size_t zeros = ZeroRun<HasBase>(state, base, pos, size);
+			pos += zeros;
+			if (pos == size)
+				break;
+
+			//the literal ends at the next zero run that's worth its lengths
+			const size_t literalStart = pos;
+			size_t literalEnd = pos;
+			size_t zeroCount = 0;
+			for (; pos < size && zeroCount < minZeroRun; ++pos)
+			{
+				if (ByteAt<HasBase>(state, base, pos) == 0)
+					++zeroCount;
+				else
+				{
+					zeroCount = 0;
+					literalEnd = pos + 1;
+				}
+			}
+			pos = literalEnd;
+
+			out = WriteLength(out, zeros);
+			out = WriteLength(out, literalEnd - literalStart);
+			for (size_t i = literalStart; i < literalEnd; ++i)
+				*out++ = ByteAt<HasBase>(state, base, i);
+		}
+
+		return size_t(out - begin);
+	}
+}
+
+RewindBuffer::RewindBuffer(uint32_t budgetMiB, uint32_t keyframeInterval)
+	: m_Ring(size_t(std::max<uint32_t>(budgetMiB, 1)) << 20) //a MiB always fits a keyframe of the whole 64 KiB
+	, m_KeyframeInterval(std::max<uint32_t>(keyframeInterval, 1))
+{
+}
+
+void RewindBuffer::Capture(const i8080Emulator& emulator)
+{
+	emulator.SaveState(m_State);
+	const size_t stateSize = m_State.size();
+
+	bool keyframe = !m_HasKeyframe || m_SinceKeyframe >= m_KeyframeInterval || m_Keyframe.size() != stateSize;
+	size_t offset;
+	while (true)
+	{
+		Encode(m_State.data(), keyframe ? nullptr : m_Keyframe.data(), stateSize);
+		if (!Allocate(m_Encoded.size(), offset))
+		{
+			assert(false);
+			return;
+		}
+
+		//making room dropped the keyframe this delta needs (only with a tiny budget)
+		if (!keyframe && m_Snapshots.empty())
+		{
+			keyframe = true;
+			continue;
+		}
+		break;
+	}
+
+	std::memcpy(m_Ring.data() + offset, m_Encoded.data(), m_Encoded.size());
+	m_Snapshots.push_back({ offset, m_Encoded.size(), stateSize, emulator.GetFrameCount(), keyframe });
+	m_Head = offset + m_Encoded.size();
+	m_UsedBytes += m_Encoded.size();
+
+	++m_Stats.captures;
+	m_Stats.stateBytes += stateSize;
+	m_Stats.storedBytes += m_Encoded.size();
+
+	if (keyframe)
+	{
+		//the old keyframe's buffer becomes the next scratch state
+		m_Keyframe.swap(m_State);
+		m_HasKeyframe = true;
+		m_SinceKeyframe = 0;
+		++m_Stats.keyframes;
+	}
+	++m_SinceKeyframe;
+}
+
+bool RewindBuffer::Rewind(i8080Emulator& emulator, uint32_t frames)
+{
+	if (m_Snapshots.empty())
+		return false;
+
+	const size_t drop = std::min<size_t>(frames, m_Snapshots.size() - 1);
+	for (size_t i = 0; i < drop; ++i)
+	{
+		m_UsedBytes -= m_Snapshots.back().size;
+		m_Snapshots.pop_back();
+	}
+
+	//the oldest snapshot is always a keyframe
+	size_t keyframeIndex = m_Snapshots.size() - 1;
+	while (!m_Snapshots[keyframeIndex].keyframe)
+		--keyframeIndex;
+
+	const Snapshot& keyframe = m_Snapshots[keyframeIndex];
+	const Snapshot& target = m_Snapshots.back();
+
+	m_Keyframe.assign(keyframe.stateSize, 0);
+	bool decoded = Apply(m_Ring.data() + keyframe.offset, keyframe.size, m_Keyframe.data(), m_Keyframe.size());
+	m_State = m_Keyframe;
+	if (decoded && !target.keyframe)
+		decoded = Apply(m_Ring.data() + target.offset, target.size, m_State.data(), m_State.size());
+
+	if (!decoded)
+	{
+		std::cerr << "Rewind snapshot is corrupted" << '\n';
+		Clear();
+		return false;
+	}
+
+	//later captures continue the chain of the restored snapshot
+	m_Head = target.offset + target.size;
+	m_HasKeyframe = true;
+	m_SinceKeyframe = uint32_t(m_Snapshots.size() - keyframeIndex);
+
+	return emulator.LoadState(m_State);
+}
+
+void RewindBuffer::Clear()
+{
+	m_Snapshots.clear();
+	m_Head = 0;
+	m_UsedBytes = 0;
+	m_HasKeyframe = false;
+	m_SinceKeyframe = 0;
+}
+
+void RewindBuffer::Encode(const uint8_t* state, const uint8_t* base, size_t size)
+{
+	//capacity is kept, only the first capture allocates
+	m_Encoded.resize(size + max_encoding_overhead);
+
+	const size_t encodedSize = base
+		? EncodeRuns<true>(state, base, size, min_zero_run, m_Encoded.data())
+		: EncodeRuns<false>(state, base, size, min_zero_run, m_Encoded.data());
+
+	assert(encodedSize <= m_Encoded.size());
+	m_Encoded.resize(encodedSize);
+}
+
+bool RewindBuffer::Apply(const uint8_t* encoded, size_t encodedSize, uint8_t* state, size_t stateSize)
+{
+	const uint8_t* const end = encoded + encodedSize;
+	size_t pos = 0;
+
+	while (encoded < end)
+	{
+		size_t zeros, literal;
+		encoded = ReadLength(encoded, end, zeros);
+		if (encoded != nullptr)
+			encoded = ReadLength(encoded, end, literal);
+		if (encoded == nullptr || zeros > stateSize - pos || literal > stateSize - pos - zeros || literal > size_t(end - encoded))
+			return false;
+		pos += zeros;
+
+		for (size_t i = 0; i < literal; ++i)
+			state[pos + i] ^= encoded[i];
+
+		encoded += literal;
+		pos += literal;
+	}
+
+	return true;
+}
+
+bool RewindBuffer::Allocate(size_t size, size_t& offset)
+{
+	if (size > m_Ring.size())
+		return false;
+
+	if (m_Snapshots.empty())
+		m_Head = 0;
+
+	//the live snapshots run from the oldest one around to m_Head
+	//the oldest ones are the first in the way, so they're dropped until the new one fits
+	offset = m_Head;
+	if (offset + size > m_Ring.size())
+	{
+		//the end of the ring is left unused, anything still in it is older than what's at the start
+		while (!m_Snapshots.empty() && m_Snapshots.front().offset >= offset)
+			EvictOldest();
+		offset = 0;
+	}
+
+	while (!m_Snapshots.empty() && m_Snapshots.front().offset >= offset && m_Snapshots.front().offset < offset + size)
+		EvictOldest();
+
+	return true;
+}
+
+void RewindBuffer::EvictOldest()
+{
+	do
+	{
+		m_UsedBytes -= m_Snapshots.front().size;
+		m_Snapshots.pop_front();
+		++m_Stats.evictions;
+	} while (!m_Snapshots.empty() && !m_Snapshots.front().keyframe);
+}
@@ -0,0 +1,93 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+class i8080Emulator;
+
+//Per-frame rewind history
+//every capture is a save state (see SaveState.h), stored XOR'd against the last keyframe and run-length compressed
+//a frame usually only changes a few hundred bytes, so most of a delta is a zero run
+//keyframes are stored the same way against an all zero state, one is taken every keyframeInterval captures
+//all snapshots live in one fixed-size ring, when it's full the oldest keyframe is dropped together with its deltas
+class RewindBuffer
+{
+public:
+	struct Stats
+	{
+		uint64_t captures{};
+		uint64_t keyframes{};
+		uint64_t stateBytes{};	//uncompressed size of everything captured
+		uint64_t storedBytes{};	//compressed size of everything captured
+		uint64_t evictions{};	//snapshots dropped to make room
+	};
+
+	static constexpr uint32_t default_keyframe_interval = 60;
+	static constexpr uint32_t default_budget_mib = 16;
+
+	RewindBuffer(uint32_t budgetMiB = default_budget_mib, uint32_t keyframeInterval = default_keyframe_interval);
+
+	RewindBuffer(const RewindBuffer& other) = delete;
+	RewindBuffer(RewindBuffer&& other) noexcept = delete;
+	RewindBuffer& operator=(const RewindBuffer& other) = delete;
+	RewindBuffer& operator=(RewindBuffer&& other) noexcept = delete;
+
+	//snapshots the emulator, call once per frame in between batches
+	void Capture(const i8080Emulator& emulator);
+	//drops the newest frames snapshots and loads the one before them, stops at the oldest one
+	//false if there's nothing to rewind to, or the snapshot doesn't decode (the history is cleared then)
+	bool Rewind(i8080Emulator& emulator, uint32_t frames = 1);
+	//after loading a different ROM or state, the history doesn't lead up to it anymore
+	void Clear();
+
+	size_t GetSnapshotCount() const { return m_Snapshots.size(); }
+	//emulated frame of the oldest snapshot that can be rewound to
+	uint64_t GetOldestFrame() const { return m_Snapshots.empty() ? 0 : m_Snapshots.front().frame; }
+	//bytes of the ring in use, it never grows beyond the budget
+	size_t GetUsedBytes() const { return m_UsedBytes; }
+	size_t GetBudgetBytes() const { return m_Ring.size(); }
+	uint32_t GetKeyframeInterval() const { return m_KeyframeInterval; }
+	const Stats& GetStats() const { return m_Stats; }
+
+private:
+	struct Snapshot
+	{
+		size_t offset;	//into m_Ring
+		size_t size;
+		size_t stateSize;
+		uint64_t frame;
+		bool keyframe;
+	};
+
+	//run-length encodes the XOR of state and base (zero when base is null) into m_Encoded
+	void Encode(const uint8_t* state, const uint8_t* base, size_t size);
+	//XORs an encoded snapshot onto state, false if it doesn't decode to stateSize bytes
+	static bool Apply(const uint8_t* encoded, size_t encodedSize, uint8_t* state, size_t stateSize);
+	//makes room at the head of the ring, false if size is bigger than the whole ring
+	bool Allocate(size_t size, size_t& offset);
+	//drops the oldest keyframe and the deltas that need it
+	void EvictOldest();
+
+	//shorter zero runs are kept in the literal, a new run costs 2 bytes of lengths
+	static constexpr size_t min_zero_run = 4;
+	//the first run's lengths, every later run saves more than its lengths cost
+	static constexpr size_t max_encoding_overhead = 16;
+
+	std::vector<uint8_t> m_Ring;
+	std::deque<Snapshot> m_Snapshots;
+	size_t m_Head{};	//where the next snapshot goes
+	size_t m_UsedBytes{};
+	uint32_t m_KeyframeInterval;
+	uint32_t m_SinceKeyframe{};
+
+	//the keyframe the next delta is taken against, uncompressed
+	std::vector<uint8_t> m_Keyframe;
+	bool m_HasKeyframe{ false };
+
+	//scratch, reused so capturing doesn't allocate
+	std::vector<uint8_t> m_State;
+	std::vector<uint8_t> m_Encoded;
+
+	Stats m_Stats{};
+};
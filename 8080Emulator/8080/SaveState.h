@@ -0,0 +1,58 @@
+#pragma once
+#include <cstdint>
+#include <type_traits>
+
+//Save state layout
+//a state is this header followed by every page of storage that has a bit set in storagePages, in page order
+//ROM pages aren't included, a state can only be loaded with the same ROM (romHash) loaded
+//the header is copied as is, it's ordered so there's no padding and the bytes of equal states are equal
+struct SaveStateHeader
+{
+	static constexpr uint32_t magic_value = 0x53303849; //"I80S"
+	static constexpr uint16_t current_version = 1;
+	static constexpr uint8_t max_events = 4;
+
+	uint32_t magic;
+	uint16_t version;
+	uint16_t headerSize;
+	uint64_t romHash;
+	uint64_t storagePages;	//bit per Memory page of storage that follows the header
+
+	uint64_t clockCount;
+	uint64_t halfFrameCount;
+	uint64_t instructionCount;
+	uint64_t skippedCycles;
+	uint64_t eventCycles[max_events]; //pending Scheduler events in the order they fire
+	//wait loop detection (see i8080Emulator::DetectIdleLoop), it decides how many cycles are skipped
+	uint64_t idleClockCount;
+	uint64_t idleIterationCycles;
+
+	uint16_t sp;
+	uint16_t pc;
+	uint16_t regShift;
+	uint16_t idleStart;
+	uint16_t idleEnd;
+	uint16_t idleSp;
+	uint8_t registers[8];	//CPU register file order
+	uint8_t flags;			//PSW layout
+	uint8_t interruptsEnabled;
+	uint8_t halt;
+	uint8_t waitingForInterrupt;
+	uint8_t shiftOffset;
+	uint8_t inPort[4];
+	uint8_t outPort[7];
+	uint8_t idleRegisters[8];
+	uint8_t idleFlags;
+
+	uint8_t consoleProgram;
+	uint8_t currentOpcode;		//an interrupt isn't accepted right after EI
+	uint8_t pendingInterrupts;	//InterruptController bit mask
+	uint8_t firstHalf;			//which display interrupt is next
+	uint8_t eventCount;
+	uint8_t events[max_events];	//Scheduler::Event
+	uint8_t reserved[2];
+};
+
+static_assert(std::is_trivially_copyable_v<SaveStateHeader>);
+static_assert(std::has_unique_object_representations_v<SaveStateHeader>, "the header can't have padding");
+static_assert(sizeof(SaveStateHeader) == 160);
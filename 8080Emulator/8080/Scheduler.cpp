@@ -0,0 +1,55 @@
+#include "Scheduler.h"
+#include <algorithm>
+#include <array>
+
+#include "SaveState.h"
+
+void Scheduler::Reset()
+{
+	m_Events.clear();
+	m_NextOrder = 0;
+}
+
+void Scheduler::Schedule(Event event, uint64_t cycle)
+{
+	m_Events.push_back({ cycle, m_NextOrder++, event });
+	std::push_heap(m_Events.begin(), m_Events.end(), Later);
+}
+
+bool Scheduler::PopDue(uint64_t currentCycle, Event& event, uint64_t& cycle)
+{
+	if (m_Events.empty() || m_Events.front().cycle > currentCycle)
+		return false;
+
+	std::pop_heap(m_Events.begin(), m_Events.end(), Later);
+	event = m_Events.back().event;
+	cycle = m_Events.back().cycle;
+	m_Events.pop_back();
+
+	return true;
+}
+
+size_t Scheduler::GetPending(Event* events, uint64_t* cycles, size_t max) const
+{
+	//the earliest ones sorted on the stack, save states and rewind captures call this every frame
+	std::array<Entry, SaveStateHeader::max_events> sorted;
+	const auto sortedEnd = std::partial_sort_copy(m_Events.begin(), m_Events.end(), sorted.begin(), sorted.end(),
+		[](const Entry& lhs, const Entry& rhs) { return Later(rhs, lhs); });
+
+	const size_t count = std::min<size_t>(max, sortedEnd - sorted.begin());
+	for (size_t i = 0; i < count; ++i)
+	{
+		events[i] = sorted[i].event;
+		cycles[i] = sorted[i].cycle;
+	}
+
+	return m_Events.size();
+}
+
+bool Scheduler::Later(const Entry& lhs, const Entry& rhs)
+{
+	if (lhs.cycle != rhs.cycle)
+		return lhs.cycle > rhs.cycle;
+
+	return lhs.order > rhs.order;
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//Device events at exact clock cycle deadlines
+//the emulator runs straight until the next deadline, services whatever is due and continues
+//kept as a binary min-heap, there's only ever a handful of events pending
+class Scheduler
+{
+public:
+	enum class Event : uint8_t
+	{
+		HalfFrame,		//mid screen (RST 1) or VBlank (RST 2)
+		KeyboardPoll,	//write the key states to the input ports
+	};
+	static constexpr uint8_t event_count = 2; //number of Event values
+
+	static constexpr uint64_t no_event = UINT64_MAX;
+
+	void Reset();
+
+	void Schedule(Event event, uint64_t cycle);
+
+	//cycle of the earliest pending event, no_event if there is none
+	uint64_t NextDeadline() const { return m_Events.empty() ? no_event : m_Events.front().cycle; }
+
+	//removes the earliest event if it's due at currentCycle
+	//events at the same cycle come out in the order they were scheduled
+	bool PopDue(uint64_t currentCycle, Event& event, uint64_t& cycle);
+
+	//copies up to max (at most SaveStateHeader::max_events) pending events in the order they'll fire, returns how many there are
+	//scheduling them again in this order after a Reset gives the same queue, used by save states
+	size_t GetPending(Event* events, uint64_t* cycles, size_t max) const;
+
+private:
+	struct Entry
+	{
+		uint64_t cycle;
+		uint64_t order; //tie breaker, keeps same cycle events deterministic
+		Event event;
+	};
+
+	//std heap functions build a max-heap, so compare the other way around
+	static bool Later(const Entry& lhs, const Entry& rhs);
+
+	std::vector<Entry> m_Events;
+	uint64_t m_NextOrder{};
+};
@@ -0,0 +1,475 @@
+#include "ScreenRenderer.h"
+#include <cassert>
+#include <deque>
+#include <mutex>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define I8080_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+//GCC and Clang only allow AVX2 intrinsics in functions compiled for it, MSVC allows them everywhere
+#if defined(I8080_X86) && defined(__GNUC__)
+#define I8080_TARGET_SSE2 __attribute__((target("sse2")))
+#define I8080_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define I8080_TARGET_SSE2
+#define I8080_TARGET_AVX2
+#endif
+
+namespace
+{
+	//4 blocks of 8 columns, 64 bytes of pixels, so every cache line of the pixel buffer is filled in one go
+	constexpr uint16_t tile_blocks = 4;
+	//VRAM bytes per column the row buffer can hold
+	constexpr uint16_t max_column_bytes = 64;
+
+	//transposes an 8x8 bit matrix, byte i bit j <-> byte j bit i
+	//Hacker's Delight 7-3, the three steps swap 1x1, 2x2 and 4x4 blocks
+	inline uint64_t TransposeBits(uint64_t x)
+	{
+		uint64_t t = (x ^ (x >> 7)) & 0x00AA00AA00AA00AAull;
+		x ^= t ^ (t << 7);
+		t = (x ^ (x >> 14)) & 0x0000CCCC0000CCCCull;
+		x ^= t ^ (t << 14);
+		t = (x ^ (x >> 28)) & 0x00000000F0F0F0F0ull;
+		x ^= t ^ (t << 28);
+		return x;
+	}
+
+	//rows[b] byte i bit c is the pixel at VRAM height b * 8 + i in column c of the block
+	void GatherBlockScalar(const uint8_t* columns, uint16_t columnBytes, uint64_t* rows)
+	{
+		for (uint16_t b = 0; b < columnBytes; ++b) {
+			uint64_t bytes = 0;
+			for (uint16_t c = 0; c < ScreenRenderer::block_width; ++c)
+				bytes |= uint64_t(columns[c * columnBytes + b]) << (c * 8);
+
+			rows[b] = TransposeBits(bytes);
+		}
+	}
+
+	//bit i of blocks that only have their neighbour in the same pair set, for the 16 column AVX2 path
+	constexpr uint32_t WholePairs(uint32_t blockMask)
+	{
+		return blockMask | ((blockMask & 0x5555'5555u) << 1) | ((blockMask & 0xAAAA'AAAAu) >> 1);
+	}
+
+#ifdef I8080_X86
+	I8080_TARGET_SSE2 inline __m128i TransposeBits(__m128i x)
+	{
+		__m128i t = _mm_and_si128(_mm_xor_si128(x, _mm_srli_epi64(x, 7)), _mm_set1_epi64x(0x00AA00AA00AA00AAll));
+		x = _mm_xor_si128(x, _mm_xor_si128(t, _mm_slli_epi64(t, 7)));
+		t = _mm_and_si128(_mm_xor_si128(x, _mm_srli_epi64(x, 14)), _mm_set1_epi64x(0x0000CCCC0000CCCCll));
+		x = _mm_xor_si128(x, _mm_xor_si128(t, _mm_slli_epi64(t, 14)));
+		t = _mm_and_si128(_mm_xor_si128(x, _mm_srli_epi64(x, 28)), _mm_set1_epi64x(0x00000000F0F0F0F0ll));
+		x = _mm_xor_si128(x, _mm_xor_si128(t, _mm_slli_epi64(t, 28)));
+		return x;
+	}
+
+	//same as GatherBlockScalar, 16 bytes of every column at a time
+	//the byte transpose is done with unpacks: 8 columns of 16 bytes -> 16 qwords of 8 columns
+	I8080_TARGET_SSE2 void GatherBlockSSE2(const uint8_t* columns, uint16_t columnBytes, uint64_t* rows)
+	{
+		for (uint16_t b = 0; b < columnBytes; b += 16) {
+			__m128i c[8];
+			for (int i = 0; i < 8; ++i)
+				c[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(columns + i * columnBytes + b));
+
+			for (int half = 0; half < 2; ++half) {
+				//first bytes 0-7 of every column, then 8-15
+				const __m128i c01 = half == 0 ? _mm_unpacklo_epi8(c[0], c[1]) : _mm_unpackhi_epi8(c[0], c[1]);
+				const __m128i c23 = half == 0 ? _mm_unpacklo_epi8(c[2], c[3]) : _mm_unpackhi_epi8(c[2], c[3]);
+				const __m128i c45 = half == 0 ? _mm_unpacklo_epi8(c[4], c[5]) : _mm_unpackhi_epi8(c[4], c[5]);
+				const __m128i c67 = half == 0 ? _mm_unpacklo_epi8(c[6], c[7]) : _mm_unpackhi_epi8(c[6], c[7]);
+
+				const __m128i c0123Lo = _mm_unpacklo_epi16(c01, c23);
+				const __m128i c0123Hi = _mm_unpackhi_epi16(c01, c23);
+				const __m128i c4567Lo = _mm_unpacklo_epi16(c45, c67);
+				const __m128i c4567Hi = _mm_unpackhi_epi16(c45, c67);
+
+				__m128i* out = reinterpret_cast<__m128i*>(rows + b + half * 8);
+				_mm_storeu_si128(out + 0, TransposeBits(_mm_unpacklo_epi32(c0123Lo, c4567Lo)));
+				_mm_storeu_si128(out + 1, TransposeBits(_mm_unpackhi_epi32(c0123Lo, c4567Lo)));
+				_mm_storeu_si128(out + 2, TransposeBits(_mm_unpacklo_epi32(c0123Hi, c4567Hi)));
+				_mm_storeu_si128(out + 3, TransposeBits(_mm_unpackhi_epi32(c0123Hi, c4567Hi)));
+			}
+		}
+	}
+#endif
+}
+
+ScreenRenderer::ScreenRenderer(uint16_t width, uint16_t height)
+	: m_Width(width)
+	, m_Height(height)
+	, m_BlockCount(width / block_width)
+	, m_Path(Path::Scalar)
+	, m_pOverlay(GetOverlay(width, height))
+	, m_Overlay(m_pOverlay->colors.data())
+{
+	assert(width % block_width == 0 && m_BlockCount <= 32);
+	assert(height % 8 == 0 && height / 8 <= max_column_bytes);
+
+	SetPath(GetBestSupportedPath());
+}
+
+ScreenRenderer::~ScreenRenderer()
+{
+	m_pOverlay = nullptr;
+	m_Overlay = nullptr;
+}
+
+const ScreenRenderer::Overlay* ScreenRenderer::GetOverlay(uint16_t width, uint16_t height)
+{
+	//a deque never moves what's already in it
+	static std::mutex mutex;
+	static std::deque<Overlay> overlays;
+
+	std::lock_guard lock(mutex);
+	for (const Overlay& overlay : overlays) {
+		if (overlay.width == width && overlay.height == height)
+			return &overlay;
+	}
+
+	Overlay& overlay = overlays.emplace_back(Overlay{ width, height, std::vector<uint16_t>(size_t(width) * height), {} });
+	for (uint16_t y = 0; y < height; ++y) {
+		const uint16_t row = static_cast<uint16_t>(height - 1 - y);
+		for (uint16_t x = 0; x < width; ++x)
+			overlay.colors[row * width + x] = OverlayColor(width, height, x, y & ~7); //the overlay is checked per VRAM byte
+	}
+
+	BuildOverlayRects(overlay);
+	return &overlay;
+}
+
+ScreenRenderer::Path ScreenRenderer::GetBestSupportedPath()
+{
+	if (IsSupported(Path::AVX2))
+		return Path::AVX2;
+	if (IsSupported(Path::SSE2))
+		return Path::SSE2;
+	return Path::Scalar;
+}
+
+bool ScreenRenderer::IsSupported(Path path)
+{
+	switch (path)
+	{
+	case Path::Reference:
+	case Path::Scalar:
+		return true;
+#if defined(I8080_X86) && defined(__GNUC__)
+	case Path::SSE2:
+		return __builtin_cpu_supports("sse2");
+	case Path::AVX2:
+		return __builtin_cpu_supports("avx2");
+#elif defined(I8080_X86) && defined(_MSC_VER)
+	case Path::SSE2:
+	{
+		int info[4];
+		__cpuid(info, 1);
+		return (info[3] & (1 << 26)) != 0;
+	}
+	case Path::AVX2:
+	{
+		int info[4];
+		__cpuid(info, 1);
+		//the OS has to save the AVX registers as well
+		const bool osxsave = (info[2] & (1 << 27)) != 0;
+		if (!osxsave || (_xgetbv(0) & 0x6) != 0x6)
+			return false;
+
+		__cpuidex(info, 7, 0);
+		return (info[1] & (1 << 5)) != 0;
+	}
+#endif
+	default:
+		return false;
+	}
+}
+
+const char* ScreenRenderer::GetPathName(Path path)
+{
+	switch (path)
+	{
+	case Path::Reference: return "reference";
+	case Path::Scalar: return "scalar";
+	case Path::SSE2: return "SSE2";
+	case Path::AVX2: return "AVX2";
+	default: return "unknown";
+	}
+}
+
+void ScreenRenderer::SetPath(Path path)
+{
+	//the vector paths convert 16 bytes of a column and (for AVX2) 16 columns at a time
+	const bool vectorSize = m_Width % 16 == 0 && m_Height % 128 == 0;
+	const bool isVector = path == Path::SSE2 || path == Path::AVX2;
+
+	m_Path = IsSupported(path) && (!isVector || vectorSize) ? path : Path::Scalar;
+}
+
+void ScreenRenderer::Render(const uint8_t* VRAM, uint16_t* pixels, uint32_t blockMask) const
+{
+	switch (m_Path)
+	{
+	case Path::Reference: RenderReference(VRAM, pixels, blockMask); break;
+	case Path::Scalar: RenderScalar(VRAM, pixels, blockMask); break;
+	case Path::SSE2: RenderSSE2(VRAM, pixels, blockMask); break;
+	case Path::AVX2: RenderAVX2(VRAM, pixels, blockMask); break;
+	}
+}
+
+void ScreenRenderer::RenderAll(const uint8_t* VRAM, uint16_t* pixels) const
+{
+	Render(VRAM, pixels, m_BlockCount == 32 ? ~0u : (1u << m_BlockCount) - 1);
+}
+
+//colour overlays that were often used in old arcade machines
+//https://youtu.be/QyjyWUrHsFc?t=95
+uint16_t ScreenRenderer::OverlayColor(uint16_t width, uint16_t height, uint16_t x, uint16_t y)
+{
+	if (y <= 60) {
+		if ((x <= 16 || x >= width - 122) && y <= 15) //white text at the bottom for the credits and lives
+			return white;
+
+		return green;
+	}
+
+	if (y >= height - 64 && y <= height - 33)
+		return red;
+
+	return white;
+}
+
+//merges the runs of equal colour in every row of the overlay into rectangles
+//rows with exactly the same runs as the row above extend those rectangles downwards
+void ScreenRenderer::BuildOverlayRects(Overlay& overlay)
+{
+	const uint16_t width = overlay.width;
+	std::vector<OverlayRect>& rects = overlay.rects;
+
+	size_t previousRowStart = 0; //rects that were extended by the previous row
+	for (uint16_t y = 0; y < overlay.height; ++y) {
+		std::vector<OverlayRect> runs;
+		const uint16_t* row = overlay.colors.data() + y * width;
+
+		for (uint16_t x = 0; x < width;) {
+			uint16_t end = x;
+			while (end < width && row[end] == row[x])
+				++end;
+
+			runs.push_back({ x, y, static_cast<uint16_t>(end - x), 1, row[x] });
+			x = end;
+		}
+
+		const size_t previousCount = rects.size() - previousRowStart;
+		bool sameRuns = y > 0 && previousCount == runs.size();
+		for (size_t i = 0; sameRuns && i < runs.size(); ++i) {
+			const OverlayRect& above = rects[previousRowStart + i];
+			sameRuns = above.x == runs[i].x && above.width == runs[i].width && above.color == runs[i].color;
+		}
+
+		if (sameRuns) {
+			for (size_t i = previousRowStart; i < rects.size(); ++i)
+				++rects[i].height;
+		}
+		else {
+			previousRowStart = rects.size();
+			rects.insert(rects.end(), runs.begin(), runs.end());
+		}
+	}
+}
+
+void ScreenRenderer::RenderMono(const uint8_t* VRAM, uint8_t* plane, uint32_t blockMask) const
+{
+	const uint16_t columnBytes = m_Height >> 3;
+	const uint16_t bytesPerLine = GetMonoBytesPerLine();
+	uint64_t rows[max_column_bytes];
+
+	for (uint16_t block = 0; block < m_BlockCount; ++block) {
+		if (!(blockMask & (1u << block)))
+			continue;
+
+		const uint8_t* columns = VRAM + block * block_width * columnBytes;
+#ifdef I8080_X86
+		if (m_Path == Path::SSE2 || m_Path == Path::AVX2)
+			GatherBlockSSE2(columns, columnBytes, rows);
+		else
+#endif
+			GatherBlockScalar(columns, columnBytes, rows);
+
+		//the transposed bytes already are the 8 pixels of a row
+		for (uint16_t b = 0; b < columnBytes; ++b)
+			for (uint16_t bit = 0; bit < 8; ++bit)
+				plane[(m_Height - 1 - (b * 8 + bit)) * bytesPerLine + block] = uint8_t(rows[b] >> (bit * 8));
+	}
+}
+
+void ScreenRenderer::RenderReference(const uint8_t* VRAM, uint16_t* pixels, uint32_t blockMask) const
+{
+	for (uint16_t x = 0; x < m_Width; x++) {
+		if (!(blockMask & (1u << (x / block_width))))
+			continue;
+
+		for (uint16_t y = 0; y < m_Height; y += 8) { //the pixels are saved in 8 bit integers
+
+			const uint8_t VRAMByte = VRAM[x * (m_Height >> 3) + (y >> 3)];
+
+			for (uint8_t bit = 0; bit < 8; bit++) {
+
+				uint16_t colorToDraw = black;
+
+				//if the bit is 1 theres a pixel we need to color
+				if (((VRAMByte >> bit) & 1)) {
+
+					if (y <= 60) {
+						colorToDraw = green;
+
+						if ((x <= 16 || x >= m_Width - 122) && y <= 15) //white text at the bottom for the credits and lives
+							colorToDraw = white;
+					}
+					else if (y >= m_Height - 64 && y <= m_Height - 33)
+						colorToDraw = red;
+					else
+						colorToDraw = white;
+				}
+
+				const uint16_t coordY = static_cast<uint16_t>(m_Height - 1 - (y + bit));
+				pixels[coordY * m_Width + x] = colorToDraw;
+			}
+		}
+	}
+}
+
+void ScreenRenderer::RenderScalar(const uint8_t* VRAM, uint16_t* pixels, uint32_t blockMask) const
+{
+	const uint16_t columnBytes = m_Height >> 3;
+	uint64_t rows[tile_blocks][max_column_bytes];
+
+	for (uint16_t tile = 0; tile < m_BlockCount; tile += tile_blocks) {
+		const uint16_t tileEnd = tile + tile_blocks < m_BlockCount ? tile + tile_blocks : m_BlockCount;
+		if (((blockMask >> tile) & ((1u << tile_blocks) - 1)) == 0)
+			continue;
+
+		for (uint16_t block = tile; block < tileEnd; ++block)
+			if (blockMask & (1u << block))
+				GatherBlockScalar(VRAM + block * block_width * columnBytes, columnBytes, rows[block - tile]);
+
+		//row by row so the pixel rows of the tile are written while they're in the cache
+		for (uint16_t b = 0; b < columnBytes; ++b) {
+			for (uint16_t bit = 0; bit < 8; ++bit) {
+				const uint32_t row = (m_Height - 1 - (b * 8 + bit)) * m_Width;
+
+				for (uint16_t block = tile; block < tileEnd; ++block) {
+					if (!(blockMask & (1u << block)))
+						continue;
+
+					const uint8_t lit = uint8_t(rows[block - tile][b] >> (bit * 8));
+					const uint32_t index = row + block * block_width;
+
+					for (uint16_t c = 0; c < block_width; ++c)
+						pixels[index + c] = ((lit >> c) & 1) ? m_Overlay[index + c] : black;
+				}
+			}
+		}
+	}
+}
+
+#ifdef I8080_X86
+I8080_TARGET_SSE2 void ScreenRenderer::RenderSSE2(const uint8_t* VRAM, uint16_t* pixels, uint32_t blockMask) const
+{
+	const uint16_t columnBytes = m_Height >> 3;
+	uint64_t rows[tile_blocks][max_column_bytes];
+
+	const __m128i columnBits = _mm_setr_epi16(1 << 0, 1 << 1, 1 << 2, 1 << 3, 1 << 4, 1 << 5, 1 << 6, 1 << 7);
+	const __m128i blackPixels = _mm_set1_epi16(static_cast<short>(black));
+
+	for (uint16_t tile = 0; tile < m_BlockCount; tile += tile_blocks) {
+		const uint16_t tileEnd = tile + tile_blocks < m_BlockCount ? tile + tile_blocks : m_BlockCount;
+		if (((blockMask >> tile) & ((1u << tile_blocks) - 1)) == 0)
+			continue;
+
+		for (uint16_t block = tile; block < tileEnd; ++block)
+			if (blockMask & (1u << block))
+				GatherBlockSSE2(VRAM + block * block_width * columnBytes, columnBytes, rows[block - tile]);
+
+		for (uint16_t b = 0; b < columnBytes; ++b) {
+			for (uint16_t bit = 0; bit < 8; ++bit) {
+				const uint32_t row = (m_Height - 1 - (b * 8 + bit)) * m_Width;
+
+				for (uint16_t block = tile; block < tileEnd; ++block) {
+					if (!(blockMask & (1u << block)))
+						continue;
+
+					//8 lit bits -> 8 lanes of 0xFFFF or 0, then pick the overlay colour or black
+					const uint8_t lit = uint8_t(rows[block - tile][b] >> (bit * 8));
+					const __m128i mask = _mm_cmpeq_epi16(_mm_and_si128(_mm_set1_epi16(lit), columnBits), columnBits);
+
+					const uint32_t index = row + block * block_width;
+					const __m128i overlay = _mm_loadu_si128(reinterpret_cast<const __m128i*>(m_Overlay + index));
+					const __m128i result = _mm_or_si128(_mm_and_si128(mask, overlay), _mm_andnot_si128(mask, blackPixels));
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(pixels + index), result);
+				}
+			}
+		}
+	}
+}
+
+I8080_TARGET_AVX2 void ScreenRenderer::RenderAVX2(const uint8_t* VRAM, uint16_t* pixels, uint32_t blockMask) const
+{
+	const uint16_t columnBytes = m_Height >> 3;
+	alignas(32) uint64_t rows[tile_blocks][max_column_bytes];
+
+	const __m256i columnBits = _mm256_setr_epi16(
+		1 << 0, 1 << 1, 1 << 2, 1 << 3, 1 << 4, 1 << 5, 1 << 6, 1 << 7,
+		1 << 8, 1 << 9, 1 << 10, 1 << 11, 1 << 12, 1 << 13, 1 << 14, static_cast<short>(1 << 15));
+	const __m256i blackPixels = _mm256_set1_epi16(static_cast<short>(black));
+
+	//16 columns at a time, so the blocks are drawn in pairs
+	blockMask = WholePairs(blockMask);
+
+	for (uint16_t tile = 0; tile < m_BlockCount; tile += tile_blocks) {
+		const uint16_t tileEnd = tile + tile_blocks < m_BlockCount ? tile + tile_blocks : m_BlockCount;
+		if (((blockMask >> tile) & ((1u << tile_blocks) - 1)) == 0)
+			continue;
+
+		for (uint16_t block = tile; block < tileEnd; ++block)
+			if (blockMask & (1u << block))
+				GatherBlockSSE2(VRAM + block * block_width * columnBytes, columnBytes, rows[block - tile]);
+
+		for (uint16_t b = 0; b < columnBytes; ++b) {
+			for (uint16_t bit = 0; bit < 8; ++bit) {
+				const uint32_t row = (m_Height - 1 - (b * 8 + bit)) * m_Width;
+
+				for (uint16_t block = tile; block < tileEnd; block += 2) {
+					if (!(blockMask & (1u << block)))
+						continue;
+
+					const uint16_t lit = uint16_t(uint8_t(rows[block - tile][b] >> (bit * 8)) | (uint8_t(rows[block - tile + 1][b] >> (bit * 8)) << 8));
+					const __m256i mask = _mm256_cmpeq_epi16(_mm256_and_si256(_mm256_set1_epi16(static_cast<short>(lit)), columnBits), columnBits);
+
+					const uint32_t index = row + block * block_width;
+					const __m256i overlay = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(m_Overlay + index));
+					const __m256i result = _mm256_blendv_epi8(blackPixels, overlay, mask);
+					_mm256_storeu_si256(reinterpret_cast<__m256i*>(pixels + index), result);
+				}
+			}
+		}
+	}
+}
+#else
+//not an x86 host, SetPath never selects these
+void ScreenRenderer::RenderSSE2(const uint8_t* VRAM, uint16_t* pixels, uint32_t blockMask) const
+{
+	RenderScalar(VRAM, pixels, blockMask);
+}
+
+void ScreenRenderer::RenderAVX2(const uint8_t* VRAM, uint16_t* pixels, uint32_t blockMask) const
+{
+	RenderScalar(VRAM, pixels, blockMask);
+}
+#endif
@@ -0,0 +1,94 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+//Converts the 1 bit per pixel VRAM into RGB444 pixels
+//VRAM is stored in columns (the screen is rotated 90 degrees in the cabinet), the pixels are stored in rows
+//so every 8 VRAM bytes at the same height in 8 neighbouring columns are transposed as an 8x8 bit block
+//and then expanded into 8 rows of 8 pixels at once, the colour overlay is a precomputed colour per pixel
+class ScreenRenderer
+{
+public:
+	enum class Path : uint8_t
+	{
+		Reference,	//bit by bit with the overlay checks per pixel, used to benchmark and verify the others
+		Scalar,
+		SSE2,
+		AVX2,
+	};
+
+	//rectangle of the screen (in pixel buffer coordinates) that gets one overlay colour
+	struct OverlayRect
+	{
+		uint16_t x, y, width, height;
+		uint16_t color; //RGB444
+	};
+
+	//amount of columns in a block, blocks are the unit that's redrawn
+	static constexpr uint16_t block_width = 8;
+
+	//width has to be a multiple of 16 and height a multiple of 128 for the vector paths
+	ScreenRenderer(uint16_t width, uint16_t height);
+	~ScreenRenderer();
+
+	ScreenRenderer(const ScreenRenderer& other) = delete;
+	ScreenRenderer(ScreenRenderer&& other) noexcept = delete;
+	ScreenRenderer& operator=(const ScreenRenderer& other) = delete;
+	ScreenRenderer& operator=(ScreenRenderer&& other) noexcept = delete;
+
+	//fastest path the host CPU supports
+	static Path GetBestSupportedPath();
+	static bool IsSupported(Path path);
+	static const char* GetPathName(Path path);
+
+	//falls back to Scalar if the path isn't supported
+	void SetPath(Path path);
+	Path GetPath() const { return m_Path; }
+
+	//renders the blocks that have their bit set in blockMask (bit 0 is columns 0-7)
+	void Render(const uint8_t* VRAM, uint16_t* pixels, uint32_t blockMask) const;
+	void RenderAll(const uint8_t* VRAM, uint16_t* pixels) const;
+
+	//rotated 1 bit per pixel plane instead of RGB444, rows of width / 8 bytes, the leftmost pixel is bit 0
+	//(QImage::Format_MonoLSB), the colours are added when it's presented using GetOverlayRects
+	void RenderMono(const uint8_t* VRAM, uint8_t* plane, uint32_t blockMask) const;
+	uint16_t GetMonoBytesPerLine() const { return m_Width / 8; }
+
+	//the overlay as a few rectangles that cover the whole screen
+	const std::vector<OverlayRect>& GetOverlayRects() const { return m_pOverlay->rects; }
+
+	static constexpr uint16_t black = 0xf000;
+	static constexpr uint16_t white = 0xffff;
+	static constexpr uint16_t green = 0xf0f0;
+	static constexpr uint16_t red	= 0xff00;
+
+private:
+	//the overlay only depends on the size, so all renderers of a size (one per emulator) share it
+	struct Overlay
+	{
+		uint16_t width;
+		uint16_t height;
+		std::vector<uint16_t> colors;
+		std::vector<OverlayRect> rects;
+	};
+
+	//built the first time a size is asked for, never freed
+	static const Overlay* GetOverlay(uint16_t width, uint16_t height);
+	static uint16_t OverlayColor(uint16_t width, uint16_t height, uint16_t x, uint16_t y);
+	static void BuildOverlayRects(Overlay& overlay);
+
+	void RenderReference(const uint8_t* VRAM, uint16_t* pixels, uint32_t blockMask) const;
+	void RenderScalar(const uint8_t* VRAM, uint16_t* pixels, uint32_t blockMask) const;
+	void RenderSSE2(const uint8_t* VRAM, uint16_t* pixels, uint32_t blockMask) const;
+	void RenderAVX2(const uint8_t* VRAM, uint16_t* pixels, uint32_t blockMask) const;
+
+	uint16_t m_Width;
+	uint16_t m_Height;
+	uint16_t m_BlockCount;
+	Path m_Path;
+
+	//no ownership
+	const Overlay* m_pOverlay;
+	//colour of every pixel if it's lit, in the layout of the pixel buffer
+	const uint16_t* m_Overlay;
+};
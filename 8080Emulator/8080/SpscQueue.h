@@ -0,0 +1,68 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+//Lock-free bounded queue for exactly one producer thread and one consumer thread
+//a ring buffer with free running head and tail counters, Capacity has to be a power of two
+//each side keeps a cached copy of the other side's counter so it only touches the shared one when it looks full/empty
+template<typename T, size_t Capacity>
+class SpscQueue
+{
+	static_assert(Capacity != 0 && (Capacity & (Capacity - 1)) == 0, "capacity has to be a power of two");
+
+public:
+	SpscQueue() = default;
+
+	SpscQueue(const SpscQueue& other) = delete;
+	SpscQueue(SpscQueue&& other) noexcept = delete;
+	SpscQueue& operator=(const SpscQueue& other) = delete;
+	SpscQueue& operator=(SpscQueue&& other) noexcept = delete;
+
+	//Producer, false if the queue is full
+	bool Push(const T& item)
+	{
+		const size_t head = m_Head.load(std::memory_order_relaxed);
+		if (head - m_TailCache == Capacity)
+		{
+			m_TailCache = m_Tail.load(std::memory_order_acquire);
+			if (head - m_TailCache == Capacity)
+				return false;
+		}
+
+		m_Items[head & index_mask] = item;
+		m_Head.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	//Consumer, false if the queue is empty
+	bool Pop(T& item)
+	{
+		const size_t tail = m_Tail.load(std::memory_order_relaxed);
+		if (tail == m_HeadCache)
+		{
+			m_HeadCache = m_Head.load(std::memory_order_acquire);
+			if (tail == m_HeadCache)
+				return false;
+		}
+
+		item = m_Items[tail & index_mask];
+		m_Tail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	//only a hint when called from the producer
+	bool IsEmpty() const { return m_Head.load(std::memory_order_acquire) == m_Tail.load(std::memory_order_acquire); }
+
+private:
+	static constexpr size_t index_mask = Capacity - 1;
+
+	T m_Items[Capacity]{};
+
+	//producer side
+	alignas(64) std::atomic<size_t> m_Head{};
+	size_t m_TailCache{};
+	//consumer side
+	alignas(64) std::atomic<size_t> m_Tail{};
+	size_t m_HeadCache{};
+};
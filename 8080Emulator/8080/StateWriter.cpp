@@ -0,0 +1,102 @@
+#include "StateWriter.h"
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+StateWriter::StateWriter()
+	: m_Thread(&StateWriter::Run, this)
+{
+}
+
+StateWriter::~StateWriter()
+{
+	{
+		std::lock_guard lock(m_Mutex);
+		m_Stop = true;
+	}
+	m_QueueChanged.notify_all();
+
+	m_Thread.join();
+}
+
+void StateWriter::Write(std::string path, std::vector<uint8_t> state)
+{
+	{
+		std::lock_guard lock(m_Mutex);
+		m_Jobs.push_back({ std::move(path), std::move(state) });
+	}
+	m_QueueChanged.notify_all();
+}
+
+void StateWriter::Flush()
+{
+	std::unique_lock lock(m_Mutex);
+	m_QueueChanged.wait(lock, [this] { return m_Jobs.empty() && !m_Writing; });
+}
+
+bool StateWriter::Read(const char* path, std::vector<uint8_t>& state)
+{
+	std::ifstream file(path, std::ios::in | std::ios::binary);
+
+	if (!file)
+	{
+		std::cerr << "Couldn't open save state " << path << '\n';
+		return false;
+	}
+
+	file.seekg(0, std::ios::end);
+	state.resize(size_t(file.tellg()));
+	file.seekg(0, std::ios::beg);
+	file.read(reinterpret_cast<char*>(state.data()), std::streamsize(state.size()));
+
+	return bool(file);
+}
+
+void StateWriter::Run()
+{
+	std::unique_lock lock(m_Mutex);
+
+	while (true)
+	{
+		m_QueueChanged.wait(lock, [this] { return m_Stop || !m_Jobs.empty(); });
+		if (m_Jobs.empty())
+			break; //only stops once everything is written
+
+		Job job = std::move(m_Jobs.front());
+		m_Jobs.pop_front();
+		m_Writing = true;
+
+		lock.unlock();
+		WriteFile(job);
+		lock.lock();
+
+		m_Writing = false;
+		m_QueueChanged.notify_all(); //for Flush
+	}
+}
+
+bool StateWriter::WriteFile(const Job& job)
+{
+	const std::string temporaryPath = job.path + ".tmp";
+
+	{
+		std::ofstream file(temporaryPath, std::ios::out | std::ios::binary | std::ios::trunc);
+		file.write(reinterpret_cast<const char*>(job.state.data()), std::streamsize(job.state.size()));
+
+		if (!file)
+		{
+			std::cerr << "Couldn't write save state " << temporaryPath << '\n';
+			return false;
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::rename(temporaryPath, job.path, error);
+	if (error)
+	{
+		std::cerr << "Couldn't write save state " << job.path << ": " << error.message() << '\n';
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+//Writes save states to disk on its own thread, so the emulation never waits for the disk
+//every file is written next to its destination first and then renamed over it,
+//a crash in the middle never leaves a half written state behind
+class StateWriter
+{
+public:
+	StateWriter();
+	//finishes the writes that are still queued
+	~StateWriter();
+
+	StateWriter(const StateWriter& other) = delete;
+	StateWriter(StateWriter&& other) noexcept = delete;
+	StateWriter& operator=(const StateWriter& other) = delete;
+	StateWriter& operator=(StateWriter&& other) noexcept = delete;
+
+	//returns immediately, the state is moved into the queue
+	void Write(std::string path, std::vector<uint8_t> state);
+	//blocks until everything queued so far is on disk
+	void Flush();
+
+	//synchronous, for loading
+	static bool Read(const char* path, std::vector<uint8_t>& state);
+
+private:
+	struct Job
+	{
+		std::string path;
+		std::vector<uint8_t> state;
+	};
+
+	void Run();
+	static bool WriteFile(const Job& job);
+
+	std::mutex m_Mutex;
+	std::condition_variable m_QueueChanged;
+	std::deque<Job> m_Jobs;
+	bool m_Writing{ false };
+	bool m_Stop{ false };
+	std::thread m_Thread; //last, it starts running in the constructor
+};
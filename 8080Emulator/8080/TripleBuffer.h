@@ -0,0 +1,56 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+//Lock-free handoff of the latest value from one producer thread to one consumer thread
+//the producer fills the back buffer and publishes it, the consumer picks up the newest published one
+//neither side ever waits on the other, frames the consumer didn't get to in time are simply replaced
+//the buffer in the middle is swapped with a single atomic exchange, its index and a "new" bit share one byte
+template<typename T>
+class TripleBuffer
+{
+public:
+	TripleBuffer() = default;
+	explicit TripleBuffer(const T& initial)
+		: m_Buffers{ initial, initial, initial }
+	{
+	}
+
+	TripleBuffer(const TripleBuffer& other) = delete;
+	TripleBuffer(TripleBuffer&& other) noexcept = delete;
+	TripleBuffer& operator=(const TripleBuffer& other) = delete;
+	TripleBuffer& operator=(TripleBuffer&& other) noexcept = delete;
+
+	//Producer
+	T& GetWriteBuffer() { return m_Buffers[m_Write]; }
+	//makes the write buffer the newest one, the producer continues in the buffer that was in the middle
+	void Publish()
+	{
+		const uint8_t previous = m_Middle.exchange(uint8_t(m_Write | fresh_bit), std::memory_order_acq_rel);
+		m_Write = previous & index_mask;
+	}
+
+	//Consumer
+	//swaps in the newest published buffer, false if nothing was published since the last call
+	bool Acquire()
+	{
+		if (!(m_Middle.load(std::memory_order_relaxed) & fresh_bit))
+			return false;
+
+		const uint8_t previous = m_Middle.exchange(m_Read, std::memory_order_acq_rel);
+		m_Read = previous & index_mask;
+		return true;
+	}
+	const T& GetReadBuffer() const { return m_Buffers[m_Read]; }
+
+private:
+	static constexpr uint8_t index_mask = 0b011;
+	static constexpr uint8_t fresh_bit = 0b100;
+
+	T m_Buffers[3]{};
+
+	//every index on its own cache line, so the two threads don't invalidate each other's
+	alignas(64) std::atomic<uint8_t> m_Middle{ 1 };
+	alignas(64) uint8_t m_Write{ 0 };	//only touched by the producer
+	alignas(64) uint8_t m_Read{ 2 };	//only touched by the consumer
+};
@@ -1,35 +1,63 @@
 #include "i8080Emulator.h"
 
 //Standard includes
-#include <thread>
-#include <chrono>
+#include <algorithm>
+#include <bit>
 #include <fstream>
 #include <bitset>
 #include <fstream>
 #include <cassert>
-#include <format>
+#include <csignal>
+#include <cstring>
 #include <iomanip>
 
 //Project includes
 #include "CPU.h"
 #include "Display.h"
+#include "FramePacer.h"
+#include "InterruptController.h"
 #include "Keyboard.h"
-
-using namespace std::chrono;
-
-uint64_t GetDeltaTime(const time_point<high_resolution_clock>* startTime) {
-
-	const auto timeDifference = high_resolution_clock::now() - *startTime;
-	return duration_cast<microseconds>(timeDifference).count(); //get microseconds
+#include "SaveState.h"
+#include "Scheduler.h"
+
+//Dispatch core, selected at build time with I8080_DISPATCH (see CMakeLists.txt)
+#if !defined(I8080_DISPATCH_TABLE) && !defined(I8080_DISPATCH_SWITCH) && !defined(I8080_DISPATCH_THREADED)
+#define I8080_DISPATCH_SWITCH
+#endif
+#if defined(I8080_DISPATCH_THREADED) && !defined(__GNUC__)
+#error "I8080_DISPATCH_THREADED needs computed goto (GCC or Clang)"
+#endif
+
+//expands M(0x00) ... M(0xFF), used to generate the switch cases and the threaded labels
+#define I8080_REPEAT_16(M, hi)													\
+	M(0x##hi##0) M(0x##hi##1) M(0x##hi##2) M(0x##hi##3)						\
+	M(0x##hi##4) M(0x##hi##5) M(0x##hi##6) M(0x##hi##7)						\
+	M(0x##hi##8) M(0x##hi##9) M(0x##hi##A) M(0x##hi##B)						\
+	M(0x##hi##C) M(0x##hi##D) M(0x##hi##E) M(0x##hi##F)
+#define I8080_REPEAT_256(M)														\
+	I8080_REPEAT_16(M, 0) I8080_REPEAT_16(M, 1) I8080_REPEAT_16(M, 2) I8080_REPEAT_16(M, 3)	\
+	I8080_REPEAT_16(M, 4) I8080_REPEAT_16(M, 5) I8080_REPEAT_16(M, 6) I8080_REPEAT_16(M, 7)	\
+	I8080_REPEAT_16(M, 8) I8080_REPEAT_16(M, 9) I8080_REPEAT_16(M, A) I8080_REPEAT_16(M, B)	\
+	I8080_REPEAT_16(M, C) I8080_REPEAT_16(M, D) I8080_REPEAT_16(M, E) I8080_REPEAT_16(M, F)
+
+//__debugbreak is MSVC only, raise SIGTRAP elsewhere so a debugger still stops here
+static void BreakIntoDebugger()
+{
+#ifdef _MSC_VER
+	__debugbreak();
+#else
+	std::raise(SIGTRAP);
+#endif
 }
 
 i8080Emulator::i8080Emulator()
 	: m_ConsoleProg(false)
 	, m_pCpu(new CPU{ this }) //2 MHz
-	, m_Memory(nullptr)
 	, m_CurrRomSize(0)
 	, m_CurrentOpcode(0x00)
-	, m_ClocksPerMs(2'000'000)
+	, m_pPacer(new FramePacer())
+	, m_pScheduler(new Scheduler())
+	, m_pInterrupts(new InterruptController())
 	, m_pDisplay(new Display("Intel 8080", 224, 256, 2))
 	, m_pKeyboard(new Keyboard(m_pCpu))
 {
@@ -47,14 +75,20 @@ i8080Emulator::~i8080Emulator() {
 	delete m_pCpu;
 	m_pCpu = nullptr;
 
-	delete[] m_Memory;
-	m_Memory = nullptr;
-
 	delete m_pDisplay;
 	m_pDisplay = nullptr;
 
 	delete m_pKeyboard;
 	m_pKeyboard = nullptr;
+
+	delete m_pScheduler;
+	m_pScheduler = nullptr;
+
+	delete m_pInterrupts;
+	m_pInterrupts = nullptr;
+
+	delete m_pPacer;
+	m_pPacer = nullptr;
 }
 
 bool i8080Emulator::LoadRom(bool consoleProgram, const char* path)
@@ -76,85 +110,591 @@ bool i8080Emulator::LoadRom(bool consoleProgram, const char* path)
 	m_CurrRomSize = file.tellg();
 	file.seekg(0, std::ios::beg);
 
-	//delete old memory load new
-	delete m_Memory;
-	m_Memory = new uint8_t[memory_size];
-	std::fill_n(m_Memory, memory_size, 0);
-	uint8_t temp[memory_size]{};
-
-	file.read(reinterpret_cast<char*>(temp), m_CurrRomSize);
-
 	//console programs start at 256
 	m_ProgramStart = m_ConsoleProg ? 0x100 : 0x0;
+	m_CurrRomSize = std::min<int64_t>(m_CurrRomSize, Memory::address_space - m_ProgramStart);
 
-	for (int64_t i{ 0 }; i < m_CurrRomSize; ++i) {
-		m_Memory[m_ProgramStart + i] = temp[i];
-	}
+	m_Memory.Reset();
+	uint8_t* rom = m_Memory.GetStorage(m_ProgramStart, uint32_t(m_CurrRomSize));
+	file.read(reinterpret_cast<char*>(rom), m_CurrRomSize);
 
 	file.close();
 
+	//FNV-1a, save states are only loaded with the same image
+	m_RomHash = 0xcbf29ce484222325;
+	for (int64_t i = 0; i < m_CurrRomSize; ++i)
+		m_RomHash = (m_RomHash ^ rom[i]) * 0x100000001b3;
+
+	MapMemory();
+
 
 	//initialize CPU
 	m_pCpu->pc = m_ProgramStart;
 	m_pCpu->sp = stack_start; //TODO: TEST
 
-	m_StartTime = high_resolution_clock::now();
+	m_pPacer->Reset(0);
+
+	//console programs don't have inputs, the frame timing is still kept for RunFrame
+	m_pScheduler->Reset();
+	m_pInterrupts->Reset();
+	m_pScheduler->Schedule(Scheduler::Event::HalfFrame, cycles_per_half_frame);
+	if (!m_ConsoleProg)
+		m_pScheduler->Schedule(Scheduler::Event::KeyboardPoll, cycles_per_keyboard_poll);
+
+	m_HalfFrameCount = 0;
+	m_InstructionCount = 0;
+	m_IdleLoop = {};
+	m_SkippedCycles = 0;
+
 	m_pCpu->halt = false;
 
 	return true;
 }
 
-void i8080Emulator::ThrottleCPU(uint64_t currentTime) {
+void i8080Emulator::Update() {
+
+	if (!IsHalted())
+	{
+		RunUntilNextEvent();
+
+		//the wall clock is only used for pacing, the devices run on the emulated clock
+		//console programs run as fast as they can
+		if (!m_ConsoleProg)
+			m_pPacer->Pace(m_pCpu->clockCount, GetFrameCount());
+	}
+}
+
+uint8_t i8080Emulator::Step()
+{
+	if (m_pCpu->halt)
+		return 0;
+
+	CycleCpu();
+	++m_InstructionCount;
+	return InstructionCycles[m_CurrentOpcode];
+}
+
+bool i8080Emulator::IsHalted() const
+{
+	return m_pCpu->halt && !m_pCpu->waitingForInterrupt;
+}
 
-	if (currentTime - m_LastThrottle <= 4000) { // Check every 4 us
+uint64_t i8080Emulator::RunCycles(uint64_t cycles, bool stopAtFrame)
+{
+	const uint64_t start = m_pCpu->clockCount;
+	const uint64_t target = start + cycles;
+	const uint64_t frame = GetFrameCount();
+
+	while (!IsHalted() && m_pCpu->clockCount < target && !(stopAtFrame && GetFrameCount() != frame)) {
+		ExecuteBatch(BatchEnd(target));
+		ServiceEvents();
+		ServiceInterrupts();
+	}
 
-		if (m_pCpu->clockCount >= (m_ClocksPerMs << 2)) { //throttle CPU
-			const uint64_t usToSleep = 4000 - (currentTime - m_LastThrottle); //sleep for the rest of the 4 us
-			std::this_thread::sleep_for(microseconds(usToSleep));
-			m_LastThrottle = GetDeltaTime(&m_StartTime);
-			m_pCpu->clockCount = 0;
+	return m_pCpu->clockCount - start;
+}
+
+uint64_t i8080Emulator::RunInstructions(uint64_t instructions, bool stopAtFrame)
+{
+	const uint64_t start = m_pCpu->clockCount;
+	const uint64_t frame = GetFrameCount();
+	//same stops as RunCycles, a pending interrupt is retried like it is between batches
+	uint64_t end = BatchEnd(m_pScheduler->NextDeadline());
+
+	while (instructions > 0 && !IsHalted() && !(stopAtFrame && GetFrameCount() != frame)) {
+		//nothing to execute in HLT, let the time pass until the next stop
+		if (m_pCpu->waitingForInterrupt)
+			ExecuteBatch(end);
+		else {
+			CycleCpu();
+			++m_InstructionCount;
+			--instructions;
+		}
+
+		if (m_pCpu->clockCount >= end) {
+			ServiceEvents();
+			ServiceInterrupts();
+			end = BatchEnd(m_pScheduler->NextDeadline());
 		}
 	}
-	else { // Host CPU is slower or equal to i8080
-		m_LastThrottle = currentTime;
-		m_pCpu->clockCount = 0;
+
+	return m_pCpu->clockCount - start;
+}
+
+uint64_t i8080Emulator::RunUntilNextEvent()
+{
+	const uint64_t start = m_pCpu->clockCount;
+
+	ExecuteBatch(BatchEnd(m_pScheduler->NextDeadline()));
+	ServiceEvents();
+	ServiceInterrupts();
+
+	return m_pCpu->clockCount - start;
+}
+
+//runs until the end of the current frame (the VBlank interrupt)
+uint64_t i8080Emulator::RunFrame()
+{
+	const uint64_t start = m_pCpu->clockCount;
+	const uint64_t frame = GetFrameCount();
+
+	while (!IsHalted() && GetFrameCount() == frame)
+		RunUntilNextEvent();
+
+	return m_pCpu->clockCount - start;
+}
+
+void i8080Emulator::SetClockSpeed(uint64_t hz)
+{
+	m_pPacer->SetClockRate(hz);
+}
+
+uint64_t i8080Emulator::GetClockSpeed() const
+{
+	return m_pPacer->GetClockRate();
+}
+
+void i8080Emulator::WriteStateHeader(SaveStateHeader& header) const
+{
+	std::memset(&header, 0, sizeof(header));
+
+	header.magic = SaveStateHeader::magic_value;
+	header.version = SaveStateHeader::current_version;
+	header.headerSize = sizeof(SaveStateHeader);
+	header.romHash = m_RomHash;
+	header.storagePages = m_Memory.GetWritableStoragePages();
+
+	header.clockCount = m_pCpu->clockCount;
+	header.halfFrameCount = m_HalfFrameCount;
+	header.instructionCount = m_InstructionCount;
+	header.skippedCycles = m_SkippedCycles;
+
+	header.sp = m_pCpu->sp;
+	header.pc = m_pCpu->pc;
+	header.regShift = m_pCpu->regShift;
+	std::memcpy(header.registers, m_pCpu->registers, sizeof(header.registers));
+	header.flags = m_pCpu->ReadFlags();
+	header.interruptsEnabled = m_pCpu->interruptsEnabled;
+	header.halt = m_pCpu->halt;
+	header.waitingForInterrupt = m_pCpu->waitingForInterrupt;
+	header.shiftOffset = m_pCpu->shiftOffset;
+	std::memcpy(header.inPort, m_pCpu->inPort, sizeof(header.inPort));
+	std::memcpy(header.outPort, m_pCpu->outPort, sizeof(header.outPort));
+
+	header.consoleProgram = m_ConsoleProg;
+	header.currentOpcode = m_CurrentOpcode;
+	header.pendingInterrupts = m_pInterrupts->GetPending();
+	header.firstHalf = m_pDisplay->IsFirstHalf();
+
+	header.idleClockCount = m_IdleLoop.clockCount;
+	header.idleIterationCycles = m_IdleLoop.iterationCycles;
+	header.idleStart = m_IdleLoop.start;
+	header.idleEnd = m_IdleLoop.end;
+	header.idleSp = m_IdleLoop.sp;
+	std::memcpy(header.idleRegisters, m_IdleLoop.registers, sizeof(header.idleRegisters));
+	header.idleFlags = m_IdleLoop.flags;
+
+	Scheduler::Event events[SaveStateHeader::max_events];
+	const size_t eventCount = m_pScheduler->GetPending(events, header.eventCycles, SaveStateHeader::max_events);
+	assert(eventCount <= SaveStateHeader::max_events);
+	header.eventCount = uint8_t(eventCount);
+	for (size_t i = 0; i < eventCount; ++i)
+		header.events[i] = uint8_t(events[i]);
+}
+
+void i8080Emulator::SaveState(std::vector<uint8_t>& state) const
+{
+	SaveStateHeader header;
+	WriteStateHeader(header);
+
+	//header and pages are copied straight in, no per byte work
+	const size_t pageCount = std::popcount(header.storagePages);
+	state.resize(sizeof(header) + pageCount * Memory::page_size);
+
+	uint8_t* out = state.data();
+	std::memcpy(out, &header, sizeof(header));
+	out += sizeof(header);
+
+	for (uint64_t pages = header.storagePages; pages != 0; pages &= pages - 1) {
+		const uint32_t page = std::countr_zero(pages);
+		std::memcpy(out, m_Memory.GetStoragePage(page), Memory::page_size);
+		out += Memory::page_size;
 	}
 }
 
-void i8080Emulator::Update() {
+bool i8080Emulator::LoadState(const uint8_t* state, size_t size)
+{
+	SaveStateHeader header;
+	if (size < sizeof(header))
+	{
+		std::cerr << "Save state is too small" << '\n';
+		return false;
+	}
+	std::memcpy(&header, state, sizeof(header));
+
+	if (header.magic != SaveStateHeader::magic_value || header.version != SaveStateHeader::current_version || header.headerSize != sizeof(header))
+	{
+		std::cerr << "Not a save state or from an unsupported version" << '\n';
+		return false;
+	}
 
-	if (!m_pCpu->halt)
+	if (header.romHash != m_RomHash || bool(header.consoleProgram) != m_ConsoleProg || header.storagePages != m_Memory.GetWritableStoragePages())
 	{
-		if (!m_ConsoleProg) {
-			const uint64_t currentTime = GetDeltaTime(&m_StartTime);
+		std::cerr << "Save state is from a different ROM" << '\n';
+		return false;
+	}
+
+	bool valid = size == sizeof(header) + std::popcount(header.storagePages) * Memory::page_size
+		&& header.eventCount <= SaveStateHeader::max_events
+		&& header.shiftOffset < 8;
 
-			ThrottleCPU(currentTime);
+	//every event is pending exactly once, the display always schedules its next half frame
+	//and ROMs poll the keyboard, without them RunFrame would never return
+	uint8_t pendingEvents = 0;
+	for (uint8_t i = 0; valid && i < header.eventCount; ++i) {
+		valid = header.events[i] < Scheduler::event_count && !(pendingEvents & (1 << header.events[i]));
+		pendingEvents |= uint8_t(1 << (header.events[i] & 7));
+	}
 
-			m_pDisplay->Update(currentTime, m_Memory + stack_start, this);
+	uint8_t expectedEvents = 1 << uint8_t(Scheduler::Event::HalfFrame);
+	if (!m_ConsoleProg)
+		expectedEvents |= 1 << uint8_t(Scheduler::Event::KeyboardPoll);
+	valid = valid && pendingEvents == expectedEvents;
 
-			m_pKeyboard->Update(currentTime);
+	if (!valid)
+	{
+		std::cerr << "Save state is corrupted" << '\n';
+		return false;
+	}
+
+	const uint8_t* in = state + sizeof(header);
+	for (uint64_t pages = header.storagePages; pages != 0; pages &= pages - 1) {
+		const uint32_t page = std::countr_zero(pages);
+		std::memcpy(m_Memory.GetStorage(page << Memory::page_shift, Memory::page_size), in, Memory::page_size);
+		in += Memory::page_size;
+	}
+	m_Memory.MarkAllDirty(); //the display has to redraw everything
+
+	ReadStateHeader(header);
+
+	return true;
+}
+
+i8080Emulator* i8080Emulator::Clone()
+{
+	i8080Emulator* clone = new i8080Emulator();
+	clone->m_ConsoleProg = m_ConsoleProg;
+	clone->m_CurrRomSize = m_CurrRomSize;
+	clone->m_ProgramStart = m_ProgramStart;
+	clone->m_RomHash = m_RomHash;
+	clone->m_IdleSkipping = m_IdleSkipping;
+	clone->m_Memory.Share(m_Memory);
+	clone->m_pPacer->SetClockRate(m_pPacer->GetClockRate());
+	clone->m_pDisplay->SetOutputEnabled(m_pDisplay->GetOutputEnabled());
+	clone->m_pDisplay->SetFrameSkip(m_pDisplay->GetFrameSkip());
+
+	//everything but the memory is in a save state
+	SaveStateHeader header;
+	WriteStateHeader(header);
+	clone->ReadStateHeader(header);
+
+	return clone;
+}
+
+void i8080Emulator::ReadStateHeader(const SaveStateHeader& header)
+{
+	m_pCpu->clockCount = header.clockCount;
+	m_HalfFrameCount = header.halfFrameCount;
+	m_InstructionCount = header.instructionCount;
+	m_SkippedCycles = header.skippedCycles;
+
+	m_pCpu->sp = header.sp;
+	m_pCpu->pc = header.pc;
+	m_pCpu->regShift = header.regShift;
+	std::memcpy(m_pCpu->registers, header.registers, sizeof(header.registers));
+	m_pCpu->SetFlags(header.flags);
+	m_pCpu->interruptsEnabled = header.interruptsEnabled;
+	m_pCpu->halt = header.halt;
+	m_pCpu->waitingForInterrupt = header.waitingForInterrupt;
+	m_pCpu->shiftOffset = header.shiftOffset;
+	std::memcpy(m_pCpu->inPort, header.inPort, sizeof(header.inPort));
+	std::memcpy(m_pCpu->outPort, header.outPort, sizeof(header.outPort));
+
+	m_CurrentOpcode = header.currentOpcode;
+	m_pInterrupts->SetPending(header.pendingInterrupts);
+	m_pDisplay->SetFirstHalf(header.firstHalf);
+
+	m_pScheduler->Reset();
+	for (uint8_t i = 0; i < header.eventCount; ++i)
+		m_pScheduler->Schedule(Scheduler::Event(header.events[i]), header.eventCycles[i]);
+
+	m_IdleLoop.clockCount = header.idleClockCount;
+	m_IdleLoop.iterationCycles = header.idleIterationCycles;
+	m_IdleLoop.start = header.idleStart;
+	m_IdleLoop.end = header.idleEnd;
+	m_IdleLoop.sp = header.idleSp;
+	std::memcpy(m_IdleLoop.registers, header.idleRegisters, sizeof(m_IdleLoop.registers));
+	m_IdleLoop.flags = header.idleFlags;
+
+	m_pPacer->Resync(m_pCpu->clockCount);
+}
+
+uint64_t i8080Emulator::GetClockCount() const
+{
+	return m_pCpu->clockCount;
+}
+
+//the hot loop, no timing or device work in here
+void i8080Emulator::ExecuteBatch(uint64_t endCycle)
+{
+	CPU& cpu = *m_pCpu;
+	uint64_t instructions{};
+	m_BatchEnd = endCycle;
+
+#if defined(I8080_DISPATCH_THREADED)
+	//threaded dispatch, every handler jumps straight to the next one
+	//instead of going back through a single (badly predicted) indirect jump
+#define I8080_LABEL_ADDRESS(n) &&op_##n,
+	static void* const labels[256]{ I8080_REPEAT_256(I8080_LABEL_ADDRESS) };
+#undef I8080_LABEL_ADDRESS
+
+#define I8080_NEXT_INSTRUCTION													\
+	if (cpu.halt || cpu.clockCount >= endCycle)									\
+		goto batchDone;															\
+	++instructions;																\
+	m_CurrentOpcode = ReadMem(cpu.pc);											\
+	goto *labels[m_CurrentOpcode];
+
+	I8080_NEXT_INSTRUCTION
+
+#define I8080_THREADED_HANDLER(n)												\
+	op_##n: {																	\
+		Execute<n>();															\
+		cpu.clockCount += InstructionCycles[n];									\
+		if (m_ConsoleProg && (cpu.pc == 0 || cpu.pc == 5))						\
+			Syscall(cpu.pc);													\
+		I8080_NEXT_INSTRUCTION													\
+	}
+	I8080_REPEAT_256(I8080_THREADED_HANDLER)
+#undef I8080_THREADED_HANDLER
+#undef I8080_NEXT_INSTRUCTION
+
+batchDone:
+#else
+	while (!cpu.halt && cpu.clockCount < endCycle) {
+		CycleCpu();
+		++instructions;
+	}
+#endif
+
+	m_InstructionCount += instructions;
+	m_BatchEnd = 0;
+
+	//a CPU in HLT just lets the clock run until something can interrupt it
+	if (cpu.waitingForInterrupt && cpu.clockCount < endCycle) {
+		m_SkippedCycles += endCycle - cpu.clockCount;
+		cpu.clockCount = endCycle;
+	}
+}
+
+uint64_t i8080Emulator::BatchEnd(uint64_t limit) const
+{
+	uint64_t end = std::min(limit, m_pScheduler->NextDeadline());
+
+	if (m_pInterrupts->HasPending())
+		end = std::min(end, m_pCpu->clockCount + interrupt_retry_cycles);
+
+	return end;
+}
+
+void i8080Emulator::ServiceEvents()
+{
+	Scheduler::Event event;
+	uint64_t cycle;
+
+	//periodic events are rescheduled from their deadline, not from the current clock count
+	//so the instruction that overshot a deadline doesn't make them drift
+	while (m_pScheduler->PopDue(m_pCpu->clockCount, event, cycle)) {
+		switch (event)
+		{
+		case Scheduler::Event::HalfFrame:
+			m_pScheduler->Schedule(event, cycle + cycles_per_half_frame);
+			HalfFrame();
+			break;
+		case Scheduler::Event::KeyboardPoll:
+			m_pScheduler->Schedule(event, cycle + cycles_per_keyboard_poll);
+			if (m_InputHook)
+				m_InputHook(cycle, m_pCpu->inPort);
+			else
+				m_pKeyboard->Poll();
+			break;
 		}
+	}
+}
+
+void i8080Emulator::RedrawDisplay()
+{
+	if (!m_ConsoleProg)
+		m_pDisplay->Draw(GetVRAM(), m_Memory.GetDirty() + stack_start);
+}
+
+void i8080Emulator::HalfFrame()
+{
+	++m_HalfFrameCount;
+
+	//console programs don't have a display, only the frame timing is kept
+	if (m_ConsoleProg)
+		return;
+
+	//VRAM that's still shared with a clone is only copied once it's going to be drawn, it isn't read otherwise
+	const uint8_t* VRAM = m_pDisplay->GetOutputEnabled() ? GetVRAM() : nullptr;
+	m_pDisplay->HalfFrame(VRAM, m_Memory.GetDirty() + stack_start, this);
+}
+
+//instructions that can be part of a wait loop, they don't write memory, the stack or output ports
+//so when one iteration ends in the same state it started in, the next one will too
+static constexpr bool IsIdleLoopOpcode(uint8_t opcode)
+{
+	if (opcode >= 0x70 && opcode <= 0x77) //MOV M,r and HLT
+		return false;
+	if (opcode >= 0x40 && opcode <= 0xBF) //MOV and the ALU ops
+		return true;
+
+	switch (opcode & 0b1100'0111)
+	{
+	case 0x04: case 0x05: case 0x06: //INR, DCR, MVI
+		return (opcode & 0b0011'1000) != 0b0011'0000; //not on M
+	case 0xC2: //Jcc
+		return true;
+	}
+
+	switch (opcode & 0b1100'1111)
+	{
+	case 0x01: case 0x03: case 0x09: case 0x0B: //LXI, INX, DAD, DCX
+		return true;
+	}
+
+	switch (opcode)
+	{
+	case 0x00: //NOP
+	case 0x07: case 0x0F: case 0x17: case 0x1F: //RLC, RRC, RAL, RAR
+	case 0x0A: case 0x1A: case 0x2A: case 0x3A: //LDAX B, LDAX D, LHLD, LDA
+	case 0x27: case 0x2F: case 0x37: case 0x3F: //DAA, CMA, STC, CMC
+	case 0xC3: case 0xDB: case 0xEB: //JMP, IN, XCHG
+	case 0xC6: case 0xCE: case 0xD6: case 0xDE: case 0xE6: case 0xEE: case 0xF6: case 0xFE: //immediate ALU ops
+		return true;
+	default:
+		return false;
+	}
+}
+
+//true if the loop can't change anything but registers and flags
+//iterationCycles is only exact because the body can't branch inside the loop, only out of it
+bool i8080Emulator::IsIdleLoopBody(uint16_t loopStart, uint16_t loopEnd, uint64_t& iterationCycles) const
+{
+	iterationCycles = 0;
+
+	uint16_t pc = loopStart;
+	while (pc < loopEnd) {
+		const uint8_t opcode = ReadMem(pc);
+		if (!IsIdleLoopOpcode(opcode))
+			return false;
+
+		//a jump into the loop would make the amount of cycles per iteration unknown
+		const bool isJump = opcode == 0xC3 || (opcode & 0b1100'0111) == 0xC2;
+		if (isJump) {
+			const uint16_t target = uint16_t(ReadMem(pc + 2) << 8) | ReadMem(pc + 1);
+			if (target >= loopStart && target <= loopEnd)
+				return false;
+		}
+
+		iterationCycles += InstructionCycles[opcode];
+		pc += OPCODE_INFO[opcode].sizeBytes;
+	}
+
+	//the body has to end exactly at the jump back
+	if (pc != loopEnd)
+		return false;
+
+	iterationCycles += InstructionCycles[ReadMem(loopEnd)];
+	return true;
+}
+
+void i8080Emulator::DetectIdleLoop(uint16_t loopStart)
+{
+	CPU& cpu = *m_pCpu;
+	IdleLoop& loop = m_IdleLoop;
+	const uint8_t flags = cpu.ReadFlags();
+
+	//interrupts and devices only run in between batches, so nothing else can change the state of the loop
+	const bool spinning = loop.iterationCycles != 0
+		&& loop.start == loopStart && loop.end == cpu.pc
+		&& cpu.clockCount - loop.clockCount == loop.iterationCycles
+		&& loop.sp == cpu.sp && loop.flags == flags
+		&& std::equal(std::begin(loop.registers), std::end(loop.registers), cpu.registers);
+
+	if (spinning) {
+		//skip whole iterations only so the loop is left at the same cycle as when it's interpreted
+		if (m_BatchEnd > cpu.clockCount) {
+			const uint64_t skipped = (m_BatchEnd - cpu.clockCount) / loop.iterationCycles * loop.iterationCycles;
+			cpu.clockCount += skipped;
+			m_SkippedCycles += skipped;
+		}
+	}
+	else if (loop.start != loopStart || loop.end != cpu.pc) {
+		loop.start = loopStart;
+		loop.end = cpu.pc;
+		if (!IsIdleLoopBody(loop.start, loop.end, loop.iterationCycles))
+			loop.iterationCycles = 0;
+	}
+
+	loop.clockCount = cpu.clockCount;
+	loop.sp = cpu.sp;
+	loop.flags = flags;
+	std::copy(std::begin(cpu.registers), std::end(cpu.registers), loop.registers);
+}
+
+void i8080Emulator::ServiceInterrupts()
+{
+	if (!m_pCpu->interruptsEnabled || !m_pInterrupts->HasPending() || IsHalted())
+		return;
 
+	//EI only takes effect after the instruction following it, so that EI RET returns before the next interrupt
+	if (m_CurrentOpcode == 0xFB && !m_pCpu->halt) {
 		CycleCpu();
+		++m_InstructionCount;
+
+		if (!m_pCpu->interruptsEnabled || IsHalted())
+			return;
 	}
+
+	const uint8_t rst = m_pInterrupts->Acknowledge();
+
+	m_pCpu->interruptsEnabled = false;
+	m_pCpu->halt = false;
+	m_pCpu->waitingForInterrupt = false;
+
+	//same as executing RST n, except the pc pushed is the one of the next instruction
+	MemWrite((m_pCpu->sp - 1), (m_pCpu->pc >> 8));
+	MemWrite((m_pCpu->sp - 2), uint8_t(m_pCpu->pc));
+	m_pCpu->sp -= 2;
+	m_pCpu->pc = uint16_t(rst << 3);
+
+	m_pCpu->clockCount += interrupt_acknowledge_cycles;
 }
 
 void i8080Emulator::Stop()
 {
 	m_pCpu->halt = true;
+	m_pCpu->waitingForInterrupt = false;
 }
 
 void i8080Emulator::CycleCpu() {
 
-	if (m_pCpu->pc >= memory_size) {
-		std::cout << "Program counter overflow\n";
-		m_pCpu->PrintRegister();
-		m_pCpu->halt = true;
-	}
-
-	m_CurrentOpcode = m_Memory[m_pCpu->pc];
+	//pc is 16 bits, it wraps around the address space like on the real CPU
+	m_CurrentOpcode = ReadMem(m_pCpu->pc);
 
-	(this->*OPCODES[m_CurrentOpcode].opcode)();
+	Dispatch(m_CurrentOpcode);
 
 	m_pCpu->clockCount += InstructionCycles[m_CurrentOpcode];
 
@@ -166,6 +706,21 @@ void i8080Emulator::CycleCpu() {
 	}
 }
 
+//TABLE calls through the generated member function pointer table
+//SWITCH calls Execute<opcode> directly so every case is inlined straight-line code
+inline void i8080Emulator::Dispatch(uint8_t opcode)
+{
+#if defined(I8080_DISPATCH_TABLE)
+	(this->*OPCODE_HANDLERS[opcode])();
+#else
+	switch (opcode) {
+#define I8080_SWITCH_CASE(n) case n: Execute<n>(); break;
+	I8080_REPEAT_256(I8080_SWITCH_CASE)
+#undef I8080_SWITCH_CASE
+	}
+#endif
+}
+
 void i8080Emulator::Syscall(uint16_t ID) {
 	switch (ID) {
 	case 0: 
@@ -176,8 +731,8 @@ void i8080Emulator::Syscall(uint16_t ID) {
 			std::cout << static_cast<char>(m_pCpu->e);
 		}
 		else if (m_pCpu->c == 9) {
-			for (int i = m_pCpu->ReadRegisterPair(RegisterPairs8080::DE); m_Memory[i] != 0x24; i++) {
-				std::cout << static_cast<char>(m_Memory[i]);
+			for (int i = m_pCpu->ReadRegisterPair<RegisterPairs8080::DE>(); ReadMem(i) != 0x24; i++) {
+				std::cout << static_cast<char>(ReadMem(i));
 			}
 		}
 		fflush(stdout);
@@ -189,37 +744,24 @@ void i8080Emulator::Syscall(uint16_t ID) {
 
 void i8080Emulator::Interrupt(uint8_t ID)
 {
-	if (!m_pCpu->interruptsEnabled)
-		return;
-
-	m_pCpu->interruptsEnabled = false; //Disable Interrupts
-
 	switch (ID)
 	{
-	case 0: 
-		m_CurrentOpcode = 0xCF; //RST 1
+	case 0:
+		m_pInterrupts->Request(1); //RST 1
 		break;
-	case 1: 
-		m_CurrentOpcode = 0xD7; //RST 2
+	case 1:
+		m_pInterrupts->Request(2); //RST 2
 		break;
 	default:
 		assert(!"should never get here!");
 		break;
 	}
-
-	//RST assumes current operation call was RST but as this is an interrupt thats not the case
-	//and thus current operation still has to be called
-	//so by decrementing the pc the correct operation will be saved to sp
-	m_pCpu->pc -= 1;
-
-	//call correct RST according to opcode set above
-	RST();
 }
 
 //used for debugging
 void i8080Emulator::PrintDisassembledRom() const
 {
-	if (m_Memory == nullptr)
+	if (m_CurrRomSize == 0)
 		return;
 
 	//not using m_Cpu->pc because we just want to print the rom not actually move the pc
@@ -227,15 +769,15 @@ void i8080Emulator::PrintDisassembledRom() const
 
 	while (pc < m_CurrRomSize)
 	{
-		const unsigned char* code = &m_Memory[pc];
-		const Opcode op = OPCODES[*code];
+		const unsigned char code[3]{ ReadMem(pc), ReadMem(uint16_t(pc + 1)), ReadMem(uint16_t(pc + 2)) };
+		const OpcodeInfo op = OPCODE_INFO[*code];
 		std::cout << std::setw(4) << std::setfill('0') << std::hex << pc << ' ';
 		std::cout << std::setw(2) << std::setfill('0') << std::hex << static_cast<int>(*code) << '\t';
 
 		std::cout << op.mnemonic << '\t';
 
 		for (int i = op.sizeBytes - 1; i >= 1; --i)
-			std::cout << std::format("{:02X}", code[i]);
+			std::cout << std::setw(2) << std::setfill('0') << std::uppercase << std::hex << static_cast<int>(code[i]) << std::nouppercase;
 
 		std::cout << '\n';
 
@@ -243,48 +785,144 @@ void i8080Emulator::PrintDisassembledRom() const
 	}
 }
 
-//safely writes to RAM
-void i8080Emulator::MemWrite(uint16_t address, uint8_t data)
+//console programs get 64 KiB of RAM
+//Space Invaders: http://www.computerarcheology.com/Arcade/SpaceInvaders/RAMUse.html
+void i8080Emulator::MapMemory()
 {
-	if (address >= memory_size) {
-		address = address % rom_size + rom_size;
-	}
-	if (!m_ConsoleProg && address < m_CurrRomSize) {
-		std::cout << "Illegal address write:" << address << '\n';
-		__debugbreak();
-	}
-	else {
-		m_Memory[address] = data;
-	}
+	if (m_ConsoleProg)
+		return; //Reset() already mapped everything as RAM
 
-}
+	//only A0-A13 are decoded, the first 16 KiB repeat over the rest of the address space
+	for (uint32_t mirror = 0; mirror < Memory::address_space; mirror += mirror_size) {
+		const uint8_t mirrored = mirror != 0 ? Memory::Mirror : 0;
 
-uint8_t i8080Emulator::ReadMem(uint16_t address)
-{
-	return m_Memory[address];
+		m_Memory.Map(uint16_t(mirror), rom_size, 0, Memory::Rom | mirrored);
+		m_Memory.Map(uint16_t(mirror + rom_size), stack_start - rom_size, rom_size, Memory::Ram | mirrored);
+		m_Memory.Map(uint16_t(mirror + stack_start), mirror_size - stack_start, stack_start, Memory::Vram | mirrored);
+	}
 }
 
 void i8080Emulator::defaultOpcode()
 {
 	std::cout << "Couldn't find opcode " << std::setw(2) << std::setfill('0') << std::hex << 
-		static_cast<int>(m_CurrentOpcode) << '\t' << OPCODES[m_CurrentOpcode].mnemonic << '\n';
+		static_cast<int>(m_CurrentOpcode) << '\t' << OPCODE_INFO[m_CurrentOpcode].mnemonic << '\n';
 	m_pCpu->PrintRegister();
 	//if you reach this at this point
 	//make sure you're not running space invaders as a console program
 	//or the other way around (see checkbox next to load rom)
-	__debugbreak(); 
+	BreakIntoDebugger(); 
 	NOP();
 }
 
 //opcode implementations
 #pragma region OpcodeFunctions
 
+//decodes the opcode at compile time and forwards to the specialized handler
+//based 8080-Programmers-Manual, see the opcode tables at the back of the book
+template<uint8_t Opcode>
+void i8080Emulator::Execute()
+{
+	constexpr Registers8080 dst = CPU::GetRegisterFromOpcode(Opcode, 3);
+	constexpr Registers8080 src = CPU::GetRegisterFromOpcode(Opcode);
+	constexpr RegisterPairs8080 pair = CPU::GetRegisterPairFromOpcode(Opcode);
+	constexpr Condition8080 condition = CPU::GetConditionFromOpcode(Opcode);
+
+	if constexpr (Opcode == 0x76) HLT(); //would be MOV M,M
+	else if constexpr ((Opcode & 0b1100'0000) == 0b0100'0000) MOV<dst, src>();
+	else if constexpr ((Opcode & 0b1100'0000) == 0b1000'0000) { //ALU operations on A, operation in the dst bits
+		if constexpr (dst == Registers8080::B) ADD<src>();
+		else if constexpr (dst == Registers8080::C) ADC<src>();
+		else if constexpr (dst == Registers8080::D) SUB<src>();
+		else if constexpr (dst == Registers8080::E) SBB<src>();
+		else if constexpr (dst == Registers8080::H) ANA<src>();
+		else if constexpr (dst == Registers8080::L) XRA<src>();
+		else if constexpr (dst == Registers8080::MEM) ORA<src>();
+		else CMP<src>();
+	}
+	else if constexpr ((Opcode & 0b1100'0111) == 0b0000'0100) INR<dst>();
+	else if constexpr ((Opcode & 0b1100'0111) == 0b0000'0101) DCR<dst>();
+	else if constexpr ((Opcode & 0b1100'0111) == 0b0000'0110) MVI<dst>();
+	else if constexpr ((Opcode & 0b1100'1111) == 0b0000'0001) LXI<pair>();
+	else if constexpr ((Opcode & 0b1100'1111) == 0b0000'0011) INX<pair>();
+	else if constexpr ((Opcode & 0b1100'1111) == 0b0000'1001) DAD<pair>();
+	else if constexpr ((Opcode & 0b1100'1111) == 0b0000'1011) DCX<pair>();
+	else if constexpr ((Opcode & 0b1100'1111) == 0b1100'0001) POP<pair>();
+	else if constexpr ((Opcode & 0b1100'1111) == 0b1100'0101) PUSH<pair>();
+	else if constexpr ((Opcode & 0b1100'0111) == 0b1100'0000) Rcc<condition>();
+	else if constexpr ((Opcode & 0b1100'0111) == 0b1100'0010) Jcc<condition>();
+	else if constexpr ((Opcode & 0b1100'0111) == 0b1100'0100) Ccc<condition>();
+	else if constexpr ((Opcode & 0b1100'0111) == 0b1100'0111) RST<(Opcode & 0b0011'1000)>();
+	else if constexpr (Opcode == 0x00) NOP();
+	else if constexpr (Opcode == 0x02) STAXB();
+	else if constexpr (Opcode == 0x07) RLC();
+	else if constexpr (Opcode == 0x0A) LDAXB();
+	else if constexpr (Opcode == 0x0F) RRC();
+	else if constexpr (Opcode == 0x12) STAXD();
+	else if constexpr (Opcode == 0x17) RAL();
+	else if constexpr (Opcode == 0x1A) LDAXD();
+	else if constexpr (Opcode == 0x1F) RAR();
+	else if constexpr (Opcode == 0x22) SHLD();
+	else if constexpr (Opcode == 0x27) DAA();
+	else if constexpr (Opcode == 0x2A) LHLD();
+	else if constexpr (Opcode == 0x2F) CMA();
+	else if constexpr (Opcode == 0x32) STA();
+	else if constexpr (Opcode == 0x37) STC();
+	else if constexpr (Opcode == 0x3A) LDA();
+	else if constexpr (Opcode == 0x3F) CMC();
+	else if constexpr (Opcode == 0xC3) JMP();
+	else if constexpr (Opcode == 0xC6) ADI();
+	else if constexpr (Opcode == 0xC9) RET();
+	else if constexpr (Opcode == 0xCD) CALL();
+	else if constexpr (Opcode == 0xCE) ACI();
+	else if constexpr (Opcode == 0xD3) OUT();
+	else if constexpr (Opcode == 0xD6) SUI();
+	else if constexpr (Opcode == 0xDB) IN();
+	else if constexpr (Opcode == 0xDE) SBI();
+	else if constexpr (Opcode == 0xE3) XTHL();
+	else if constexpr (Opcode == 0xE6) ANI();
+	else if constexpr (Opcode == 0xE9) PCHL();
+	else if constexpr (Opcode == 0xEB) XCHG();
+	else if constexpr (Opcode == 0xEE) XRI();
+	else if constexpr (Opcode == 0xF3) DI();
+	else if constexpr (Opcode == 0xF6) ORI();
+	else if constexpr (Opcode == 0xF9) SPHL();
+	else if constexpr (Opcode == 0xFB) EI();
+	else if constexpr (Opcode == 0xFE) CPI();
+	else defaultOpcode(); //undocumented opcodes
+}
+
+template<size_t... Opcodes>
+constexpr std::array<i8080Emulator::OpcodeHandler, 256> i8080Emulator::MakeOpcodeHandlers(std::index_sequence<Opcodes...>)
+{
+	return { &i8080Emulator::Execute<Opcodes>... };
+}
+
+constexpr std::array<i8080Emulator::OpcodeHandler, 256> i8080Emulator::OPCODE_HANDLERS = MakeOpcodeHandlers(std::make_index_sequence<256>{});
+
+template<Registers8080 Reg>
+uint8_t i8080Emulator::ReadOperand()
+{
+	if constexpr (Reg == Registers8080::MEM)
+		return ReadMem(m_pCpu->ReadRegisterPair<RegisterPairs8080::HL>());
+	else
+		return m_pCpu->Register<Reg>();
+}
+
+template<Registers8080 Reg>
+void i8080Emulator::WriteOperand(uint8_t value)
+{
+	if constexpr (Reg == Registers8080::MEM)
+		MemWrite(m_pCpu->ReadRegisterPair<RegisterPairs8080::HL>(), value);
+	else
+		m_pCpu->Register<Reg>() = value;
+}
+
 #pragma region GenericOpcodeFunctions
 //fetches a PC from the stack
 void i8080Emulator::RETURN(bool condition)
 {
 	if (condition) {
-		m_pCpu->pc = uint16_t(m_Memory[m_pCpu->sp + 1] << 8) | m_Memory[m_pCpu->sp];
+		m_pCpu->pc = uint16_t(ReadMem(m_pCpu->sp + 1) << 8) | ReadMem(m_pCpu->sp);
 		m_pCpu->sp += 2;
 	}
 	else {
@@ -311,7 +949,7 @@ void i8080Emulator::CALLif(bool condition)
 		MemWrite((m_pCpu->sp - 2), ((m_pCpu->pc + 3) & 0x00FF));
 		m_pCpu->sp -= 2;
 
-		m_pCpu->pc = uint16_t(m_Memory[m_pCpu->pc + 2] << 8) | m_Memory[m_pCpu->pc + 1];
+		m_pCpu->pc = uint16_t(ReadMem(m_pCpu->pc + 2) << 8) | ReadMem(m_pCpu->pc + 1);
 	}
 	else {
 		m_pCpu->pc += 3;
@@ -321,7 +959,12 @@ void i8080Emulator::CALLif(bool condition)
 void i8080Emulator::JUMP(bool condition)
 {
 	if (condition) {
-		const uint16_t address = uint16_t(m_Memory[m_pCpu->pc + 2] << 8) | m_Memory[m_pCpu->pc + 1];
+		const uint16_t address = uint16_t(ReadMem(m_pCpu->pc + 2) << 8) | ReadMem(m_pCpu->pc + 1);
+
+		//a short jump back might be a wait loop
+		if (address <= m_pCpu->pc && m_pCpu->pc - address <= idle_loop_max_bytes && m_IdleSkipping && m_BatchEnd != 0) [[unlikely]]
+			DetectIdleLoop(address);
+
 		m_pCpu->pc = address;
 	}
 	else {
@@ -329,70 +972,67 @@ void i8080Emulator::JUMP(bool condition)
 	}
 }
 
+template<RegisterPairs8080 Pair>
 void i8080Emulator::POP()
 {
-	const RegisterPairs8080 pair = m_pCpu->GetRegisterPairFromOpcode(m_CurrentOpcode);
-	const uint16_t value = uint16_t(m_Memory[m_pCpu->sp + 1] << 8) | m_Memory[m_pCpu->sp];
+	const uint16_t value = uint16_t(ReadMem(m_pCpu->sp + 1) << 8) | ReadMem(m_pCpu->sp);
 
-	if (pair == RegisterPairs8080::SP){ //special case in the pop operation sp is replaced by a and has special calculations see page 23 8080-Programmers-Manual
+	if constexpr (Pair == RegisterPairs8080::SP) { //special case in the pop operation sp is replaced by a and has special calculations see page 23 8080-Programmers-Manual
 		m_pCpu->a = (value >> 8);
 		m_pCpu->SetFlags(value & 0x00FF);
 	}
 	else
-		m_pCpu->SetRegisterPair(pair, value);
+		m_pCpu->SetRegisterPair<Pair>(value);
 
 	m_pCpu->sp += 2;
 	m_pCpu->pc += 1;
 }
 
 //decrement register pair
+template<RegisterPairs8080 Pair>
 void i8080Emulator::DCX()
 {
-	const RegisterPairs8080 pair = m_pCpu->GetRegisterPairFromOpcode(m_CurrentOpcode);
-	const uint16_t result = m_pCpu->ReadRegisterPair(pair) - 1;
-	m_pCpu->SetRegisterPair(pair, result);
+	m_pCpu->SetRegisterPair<Pair>(m_pCpu->ReadRegisterPair<Pair>() - 1);
 	m_pCpu->pc += 1;
 }
 
 //add register pair to HL
+template<RegisterPairs8080 Pair>
 void i8080Emulator::DAD()
 {
-	const RegisterPairs8080 pair = m_pCpu->GetRegisterPairFromOpcode(m_CurrentOpcode);
-	const uint32_t result = m_pCpu->ReadRegisterPair(RegisterPairs8080::HL) + m_pCpu->ReadRegisterPair(pair);
-	m_pCpu->SetRegisterPair(RegisterPairs8080::HL, uint16_t(result));
-	m_pCpu->ConditionBits.c = (result > 0xFFFF);
+	const uint32_t result = m_pCpu->ReadRegisterPair<RegisterPairs8080::HL>() + m_pCpu->ReadRegisterPair<Pair>();
+	m_pCpu->SetRegisterPair<RegisterPairs8080::HL>(uint16_t(result));
+	m_pCpu->SetCarry(result > 0xFFFF);
 	m_pCpu->pc += 1;
 }
 
 //decrements register
+template<Registers8080 Reg>
 void i8080Emulator::DCR()
 {
-	const Registers8080 reg = m_pCpu->GetRegisterFromOpcode(m_CurrentOpcode, 3);
-	const uint8_t result = m_pCpu->ReadRegister(reg) - 1;
-	m_pCpu->SetRegister(reg, result);
+	const uint8_t result = ReadOperand<Reg>() - 1;
+	WriteOperand<Reg>(result);
 	m_pCpu->UpdateFlags(result);
 	m_pCpu->pc += 1;
 }
 
 //sets a register to the byte after PC
+template<Registers8080 Reg>
 void i8080Emulator::MVI()
 {
-	const Registers8080 reg = m_pCpu->GetRegisterFromOpcode(m_CurrentOpcode, 3);
-	m_pCpu->SetRegister(reg, m_Memory[m_pCpu->pc + 1]);
+	WriteOperand<Reg>(ReadMem(m_pCpu->pc + 1));
 	m_pCpu->pc += 2;
 }
 
 //see page 3 8080-Programmers-Manual [STACK PUSH OPERATION]
+template<RegisterPairs8080 Pair>
 void i8080Emulator::PUSH()
 {
-	const RegisterPairs8080 pair = m_pCpu->GetRegisterPairFromOpcode(m_CurrentOpcode);
-
 	uint16_t value{};
-	if (pair == RegisterPairs8080::SP) //special case in the push operation sp is replaced by a and has special calculations see page 22-23 8080-Programmers-Manual
+	if constexpr (Pair == RegisterPairs8080::SP) //special case in the push operation sp is replaced by a and has special calculations see page 22-23 8080-Programmers-Manual
 		value = uint16_t(m_pCpu->a << 8) | m_pCpu->ReadFlags();
 	else
-		value = m_pCpu->ReadRegisterPair(pair);
-		
+		value = m_pCpu->ReadRegisterPair<Pair>();
 
 	MemWrite((m_pCpu->sp - 1), (value & 0xFF00) >> 8);
 	MemWrite((m_pCpu->sp - 2), (value & 0x00FF));
@@ -401,45 +1041,183 @@ void i8080Emulator::PUSH()
 }
 
 //loads immediate into register pair
+template<RegisterPairs8080 Pair>
 void i8080Emulator::LXI()
 {
-	const RegisterPairs8080 pair = m_pCpu->GetRegisterPairFromOpcode(m_CurrentOpcode);
-	m_pCpu->SetRegisterPair(pair,m_Memory[m_pCpu->pc + 1], m_Memory[m_pCpu->pc + 2]);
-
+	m_pCpu->SetRegisterPair<Pair>(uint16_t(ReadMem(m_pCpu->pc + 2) << 8) | ReadMem(m_pCpu->pc + 1));
 	m_pCpu->pc += 3;
 }
 
 //increments register pair
+template<RegisterPairs8080 Pair>
 void i8080Emulator::INX()
 {
-	const RegisterPairs8080 pair = m_pCpu->GetRegisterPairFromOpcode(m_CurrentOpcode);
-	const uint16_t result = m_pCpu->ReadRegisterPair(pair) + 1;
-	m_pCpu->SetRegisterPair(pair, result);
+	m_pCpu->SetRegisterPair<Pair>(m_pCpu->ReadRegisterPair<Pair>() + 1);
 	m_pCpu->pc += 1;
 }
 
 //increments given register by one
+template<Registers8080 Reg>
 void i8080Emulator::INR()
 {
-	const Registers8080 reg = m_pCpu->GetRegisterFromOpcode(m_CurrentOpcode, 3);
-	const uint8_t result = m_pCpu->ReadRegister(reg) + 1;
-	m_pCpu->SetRegister(reg, result);
+	const uint8_t result = ReadOperand<Reg>() + 1;
+	WriteOperand<Reg>(result);
 	m_pCpu->UpdateFlags(result);
 	m_pCpu->pc += 1;
 }
+
+template<Registers8080 Dst, Registers8080 Src>
+void i8080Emulator::MOV()
+{
+	WriteOperand<Dst>(ReadOperand<Src>());
+	m_pCpu->pc += 1;
+}
+
+//add a register/mem value onto A, and update all flags
+template<Registers8080 Reg>
+void i8080Emulator::ADD()
+{
+	const uint8_t value = ReadOperand<Reg>();
+
+	const uint16_t sum = m_pCpu->a + value;
+	m_pCpu->UpdateAuxCarry(m_pCpu->a, value, sum);
+	m_pCpu->SetCarry(sum > 0xFF);
+	m_pCpu->a = (sum & 0xFF);
+	m_pCpu->UpdateFlags(m_pCpu->a);
+	m_pCpu->pc += 1;
+}
+
+//add a register/mem value + carry bit onto A, update registers
+template<Registers8080 Reg>
+void i8080Emulator::ADC()
+{
+	const uint8_t value = ReadOperand<Reg>();
+
+	const uint16_t sum = m_pCpu->a + value + m_pCpu->Carry();
+	m_pCpu->UpdateAuxCarry(m_pCpu->a, value, sum);
+	m_pCpu->SetCarry(sum > 0xFF);
+	m_pCpu->a = (sum & 0xFF);
+	m_pCpu->UpdateFlags(m_pCpu->a);
+	m_pCpu->pc += 1;
+}
+
+//sub a register/mem value from A, and update all flags
+template<Registers8080 Reg>
+void i8080Emulator::SUB()
+{
+	const uint8_t value = ReadOperand<Reg>();
+
+	const uint16_t sum = m_pCpu->a + value + 1;//(1-(uint8_t)m_Cpu->ConditionBits.c);
+	m_pCpu->UpdateAuxCarry(m_pCpu->a, value, sum);
+	m_pCpu->SetCarry(sum > 0xFF);
+
+	m_pCpu->a -= value;
+	m_pCpu->pc += 1;
+}
+
+//SBB Subtract Register or Memory From Accumulator With Borrow
+template<Registers8080 Reg>
+void i8080Emulator::SBB()
+{
+	const uint8_t value = ReadOperand<Reg>();
+
+	const uint16_t result = m_pCpu->a - (value + m_pCpu->Carry());
+
+	const uint16_t sum = m_pCpu->a + value + (1 - m_pCpu->Carry());
+	m_pCpu->UpdateAuxCarry(m_pCpu->a, value, sum);
+	m_pCpu->SetCarry(sum > 0xFF);
+
+	m_pCpu->a = (result & 0xFF);
+
+	m_pCpu->pc += 1;
+}
+
+//bitwise AND a register/mem value with A
+template<Registers8080 Reg>
+void i8080Emulator::ANA()
+{
+	m_pCpu->a &= ReadOperand<Reg>();
+
+	m_pCpu->SetCarry(false);
+	m_pCpu->UpdateFlags(m_pCpu->a);
+
+	m_pCpu->pc += 1;
+}
+
+//bitwise XOR a register/mem value with A, update registers
+template<Registers8080 Reg>
+void i8080Emulator::XRA()
+{
+	m_pCpu->a ^= ReadOperand<Reg>();
+
+	m_pCpu->SetCarry(false);
+	m_pCpu->UpdateFlags(m_pCpu->a);
+
+	m_pCpu->pc += 1;
+}
+
+//bitwise OR a register/mem value with A, update registers
+template<Registers8080 Reg>
+void i8080Emulator::ORA()
+{
+	m_pCpu->a |= ReadOperand<Reg>();
+
+	m_pCpu->SetCarry(false);
+	m_pCpu->UpdateFlags(m_pCpu->a);
+	m_pCpu->pc += 1;
+}
+
+//compare a register/mem value with A, update registers
+template<Registers8080 Reg>
+void i8080Emulator::CMP()
+{
+	const uint8_t value = ReadOperand<Reg>();
+
+	const uint16_t result = m_pCpu->a - value;
+	m_pCpu->UpdateAuxCarry(m_pCpu->a, value, result);
+	m_pCpu->SetCarry((result & 0xFF00) != 0);
+	m_pCpu->UpdateFlags(uint8_t(result));
+
+	m_pCpu->pc += 1;
+}
+
+//conditional return, jump and call (RNZ, JZ, CPE, ...)
+template<Condition8080 Cond>
+void i8080Emulator::Rcc()
+{
+	RETURN(m_pCpu->TestCondition<Cond>());
+}
+
+template<Condition8080 Cond>
+void i8080Emulator::Jcc()
+{
+	JUMP(m_pCpu->TestCondition<Cond>());
+}
+
+template<Condition8080 Cond>
+void i8080Emulator::Ccc()
+{
+	CALLif(m_pCpu->TestCondition<Cond>());
+}
+
+template<uint8_t Vector>
+void i8080Emulator::RST()
+{
+	RESTART(Vector);
+}
 #pragma endregion GenericOpcodeFunctions
 
 ////////////////////////////////////////////////////
 ////////////////////////////////////////////////////
 
 void i8080Emulator::NOP() {
-	m_pCpu->pc += OPCODES[0x00].sizeBytes;
+	m_pCpu->pc += OPCODE_INFO[0x00].sizeBytes;
 }
 
 //write A to mem at address BC 
 void i8080Emulator::STAXB() {
-	MemWrite(m_pCpu->ReadRegisterPair(RegisterPairs8080::BC), m_pCpu->a);
-	m_pCpu->pc += OPCODES[0x02].sizeBytes;
+	MemWrite(m_pCpu->ReadRegisterPair<RegisterPairs8080::BC>(), m_pCpu->a);
+	m_pCpu->pc += OPCODE_INFO[0x02].sizeBytes;
 }
 
 //bit shift A left, bit 0 & Cy = prev bit 7
@@ -447,13 +1225,13 @@ void i8080Emulator::RLC() {
 	uint8_t oldBit7 = (m_pCpu->a & 128) >> 7;
 	m_pCpu->a <<= 1;
 	m_pCpu->a = m_pCpu->a | oldBit7;
-	m_pCpu->ConditionBits.c = (1 == oldBit7);
+	m_pCpu->SetCarry(1 == oldBit7);
 	m_pCpu->pc += 1;
 }
 
 //set register A to the contents or memory pointed by BC
 void i8080Emulator::LDAXB() {
-	m_pCpu->a = m_Memory[m_pCpu->ReadRegisterPair(RegisterPairs8080::BC)];
+	m_pCpu->a = ReadMem(m_pCpu->ReadRegisterPair<RegisterPairs8080::BC>());
 	m_pCpu->pc += 1;
 }
 
@@ -462,44 +1240,44 @@ void i8080Emulator::RRC() {
 	uint8_t oldBit0 = (m_pCpu->a & 1);
 	m_pCpu->a >>= 1;
 	m_pCpu->a = m_pCpu->a | (oldBit0 << 7);
-	m_pCpu->ConditionBits.c = (1 == oldBit0);
-	m_pCpu->pc += OPCODES[0x0F].sizeBytes;
+	m_pCpu->SetCarry(1 == oldBit0);
+	m_pCpu->pc += OPCODE_INFO[0x0F].sizeBytes;
 }
 
 //stores A into the address pointed to by the D reg pair
 void i8080Emulator::STAXD() {
-	MemWrite(m_pCpu->ReadRegisterPair(RegisterPairs8080::DE), m_pCpu->a);
-	m_pCpu->pc += OPCODES[0x12].sizeBytes;
+	MemWrite(m_pCpu->ReadRegisterPair<RegisterPairs8080::DE>(), m_pCpu->a);
+	m_pCpu->pc += OPCODE_INFO[0x12].sizeBytes;
 }
 
 //the contents of the accumulator are rotated one bit position to the left
 void i8080Emulator::RAL() {
 	uint8_t oldA = m_pCpu->a;
 	m_pCpu->a <<= 1;
-	m_pCpu->a = m_pCpu->a | uint8_t(m_pCpu->ConditionBits.c);
-	m_pCpu->ConditionBits.c = (oldA >= 128);
-	m_pCpu->pc += OPCODES[0x17].sizeBytes;
+	m_pCpu->a = m_pCpu->a | m_pCpu->Carry();
+	m_pCpu->SetCarry(oldA >= 128);
+	m_pCpu->pc += OPCODE_INFO[0x17].sizeBytes;
 }
 
 //store the value at the memory referenced by DE in A
 void i8080Emulator::LDAXD() {
-	m_pCpu->a = m_Memory[m_pCpu->ReadRegisterPair(RegisterPairs8080::DE)];
-	m_pCpu->pc += OPCODES[0x1A].sizeBytes;
+	m_pCpu->a = ReadMem(m_pCpu->ReadRegisterPair<RegisterPairs8080::DE>());
+	m_pCpu->pc += OPCODE_INFO[0x1A].sizeBytes;
 }
 
 //rotate A right one, bit 7 = prev CY, CY = prevbit0
 void i8080Emulator::RAR() {
 	uint8_t oldA = m_pCpu->a;
 	m_pCpu->a >>= 1;
-	m_pCpu->a = m_pCpu->a | (m_pCpu->ConditionBits.c ? 0x80 : 0x00);
-	m_pCpu->ConditionBits.c = (0x01 == (oldA & 0x01));
+	m_pCpu->a = m_pCpu->a | (m_pCpu->Carry() ? 0x80 : 0x00);
+	m_pCpu->SetCarry(0x01 == (oldA & 0x01));
 	m_pCpu->pc += 1;
 }
 
 //stores HL into address listed after m_Cpu->pc
 //adr <- L , adr+1 <- H
 void i8080Emulator::SHLD() {
-	uint16_t address = (m_Memory[m_pCpu->pc + 2] << 8) | m_Memory[m_pCpu->pc + 1];
+	uint16_t address = (ReadMem(m_pCpu->pc + 2) << 8) | ReadMem(m_pCpu->pc + 1);
 	MemWrite(address, m_pCpu->l);
 	MemWrite(address + 1, m_pCpu->h);
 	m_pCpu->pc += 3;
@@ -509,12 +1287,14 @@ void i8080Emulator::SHLD() {
 //accumulator is adjusted to form two four-bit binary coded decimals
 void i8080Emulator::DAA() {
 
-	if (((m_pCpu->a & 0x0F) > 0x09) || m_pCpu->ConditionBits.ac) {
+	m_pCpu->ResolveFlags(); //needs AC
+
+	if (((m_pCpu->a & 0x0F) > 0x09) || m_pCpu->AuxCarry()) {
 		m_pCpu->a += 0x06;
 	}
 
-	if (((m_pCpu->a & 0xF0) > 0x90) || m_pCpu->ConditionBits.c) {
-		m_pCpu->ConditionBits.c = true;
+	if (((m_pCpu->a & 0xF0) > 0x90) || m_pCpu->Carry()) {
+		m_pCpu->SetCarry(true);
 		m_pCpu->a += 0x60;
 	}
 
@@ -525,9 +1305,9 @@ void i8080Emulator::DAA() {
 //read memory from 2bytes after m_Cpu->pc into HL
 // L <- adr, H <- adr+1
 void i8080Emulator::LHLD() {
-	uint16_t address = ((m_Memory[m_pCpu->pc + 2] << 8) | m_Memory[m_pCpu->pc + 1]);
-	m_pCpu->l = m_Memory[address];
-	m_pCpu->h = m_Memory[address + 1];
+	uint16_t address = ((ReadMem(m_pCpu->pc + 2) << 8) | ReadMem(m_pCpu->pc + 1));
+	m_pCpu->l = ReadMem(address);
+	m_pCpu->h = ReadMem(address + 1);
 	m_pCpu->pc += 3;
 }
 
@@ -547,183 +1327,50 @@ void i8080Emulator::CMA() {
 //// 0x32 | stores A into the address from bytes after m_Cpu->pc
 //// adr.low = m_Cpu->pc+1, adr.hi = m_Cpu->pc+2
 void i8080Emulator::STA() {
-	const uint16_t address = uint16_t(m_Memory[m_pCpu->pc + 2] << 8) | m_Memory[m_pCpu->pc + 1];
+	const uint16_t address = uint16_t(ReadMem(m_pCpu->pc + 2) << 8) | ReadMem(m_pCpu->pc + 1);
 	MemWrite(address, m_pCpu->a);
 
-	m_pCpu->pc += OPCODES[0x32].sizeBytes;
+	m_pCpu->pc += OPCODE_INFO[0x32].sizeBytes;
 }
 
 //set carry flag to 1
 void i8080Emulator::STC() {
-	m_pCpu->ConditionBits.c = true;
+	m_pCpu->SetCarry(true);
 	m_pCpu->pc += 1;
 }
 
 //set reg A to the value pointed by bytes after m_Cpu->pc
 void i8080Emulator::LDA() {
-	m_pCpu->a = m_Memory[((m_Memory[m_pCpu->pc + 2] << 8) | m_Memory[m_pCpu->pc + 1])];
-	m_pCpu->pc += OPCODES[0x3A].sizeBytes;
+	m_pCpu->a = ReadMem(uint16_t(ReadMem(m_pCpu->pc + 2) << 8) | ReadMem(m_pCpu->pc + 1));
+	m_pCpu->pc += OPCODE_INFO[0x3A].sizeBytes;
 }
 
 //invert carry flag
 void i8080Emulator::CMC() {
-	m_pCpu->ConditionBits.c = !m_pCpu->ConditionBits.c;
-	m_pCpu->pc += 1;
-}
-
-void i8080Emulator::MOV() {
-
-	const auto src = m_pCpu->GetRegisterFromOpcode(m_CurrentOpcode);
-	const auto dest = m_pCpu->GetRegisterFromOpcode(m_CurrentOpcode, 3);
-
-	m_pCpu->SetRegister(dest, m_pCpu->ReadRegister(src));
+	m_pCpu->flags ^= CPU::flag_c;
 	m_pCpu->pc += 1;
 }
 
 //halt
 void i8080Emulator::HLT() {
 	m_pCpu->halt = true;
+	//only an interrupt resumes from HLT, without them (or without any interrupting devices) it stops for good
+	m_pCpu->waitingForInterrupt = m_pCpu->interruptsEnabled && !m_ConsoleProg;
 	m_pCpu->pc += 1;
 }
 
-//add a register/mem value onto A, and update all flags
-void i8080Emulator::ADD() {
-	Registers8080 reg = m_pCpu->GetRegisterFromOpcode(m_CurrentOpcode);
-
-	uint16_t sum = m_pCpu->a + m_pCpu->ReadRegister(reg);
-	m_pCpu->ConditionBits.ac = (sum ^ m_pCpu->a ^ m_pCpu->ReadRegister(reg)) & (1 << 4);
-	m_pCpu->ConditionBits.c = sum > 0xFF;
-	m_pCpu->a = (sum & 0xFF);
-	m_pCpu->UpdateFlags(m_pCpu->a);
-	m_pCpu->pc += 1;
-}
-
-//add a register/mem value + carry bit onto A, update registers
-void i8080Emulator::ADC() {
-	Registers8080 reg = m_pCpu->GetRegisterFromOpcode(m_CurrentOpcode);
-
-	uint16_t sum = m_pCpu->a + m_pCpu->ReadRegister(reg) + (uint8_t)m_pCpu->ConditionBits.c;
-	m_pCpu->ConditionBits.ac = (sum ^ m_pCpu->a ^ m_pCpu->ReadRegister(reg)) & (1 << 4);
-	m_pCpu->ConditionBits.c = sum > 0xFF;
-	m_pCpu->a = (sum & 0xFF);
-	m_pCpu->UpdateFlags(m_pCpu->a);
-	m_pCpu->pc += 1;
-}
-
-//sub a register/mem value from A, and update all flags
-void i8080Emulator::SUB() {
-	const Registers8080 reg = m_pCpu->GetRegisterFromOpcode(m_CurrentOpcode);
-
-	uint16_t sum = m_pCpu->a + m_pCpu->ReadRegister(reg) + 1;//(1-(uint8_t)m_Cpu->ConditionBits.c);
-	m_pCpu->ConditionBits.ac = (sum ^ m_pCpu->a ^ m_pCpu->ReadRegister(reg)) & (1 << 4);
-	m_pCpu->ConditionBits.c = sum > 0xFF;
-
-	m_pCpu->a -= m_pCpu->ReadRegister(reg);
-	m_pCpu->pc += 1;
-}
-
-//SBB Subtract Register or Memory From Accumulator With Borrow
-void i8080Emulator::SBB() {
-	const Registers8080 reg = m_pCpu->GetRegisterFromOpcode(m_CurrentOpcode);
-
-	uint16_t result = m_pCpu->a - (m_pCpu->ReadRegister(reg) + m_pCpu->ConditionBits.c);
-
-	uint16_t sum = m_pCpu->a + m_pCpu->ReadRegister(reg) + (1 - (uint8_t)m_pCpu->ConditionBits.c);
-	m_pCpu->ConditionBits.ac = (sum ^ m_pCpu->a ^ m_pCpu->ReadRegister(reg)) & (1 << 4);
-	m_pCpu->ConditionBits.c = sum > 0xFF;
-
-	m_pCpu->a = (result & 0xFF);
-
-	m_pCpu->pc += 1;
-}
-
-//bitwise AND a register/mem value with A
-void i8080Emulator::ANA() {
-	const Registers8080 reg = m_pCpu->GetRegisterFromOpcode(m_CurrentOpcode);
-
-	const uint16_t result = m_pCpu->a & m_pCpu->ReadRegister(reg);
-	m_pCpu->a = (result & 0xFF);
-
-	m_pCpu->ConditionBits.c = false;
-	m_pCpu->UpdateFlags(m_pCpu->a);
-
-	m_pCpu->pc += 1;
-}
-
-//bitwise XOR a register/mem value with A, update registers
-void i8080Emulator::XRA() {
-	const Registers8080 reg = m_pCpu->GetRegisterFromOpcode(m_CurrentOpcode);
-
-	const uint16_t result = m_pCpu->a ^ m_pCpu->ReadRegister(reg);
-	m_pCpu->a = (result & 0xFF);
-
-	m_pCpu->ConditionBits.c = false;
-	m_pCpu->UpdateFlags(m_pCpu->a);
-
-	m_pCpu->pc += 1;
-}
-
-//bitwise OR a register/mem value with A, update registers
-void i8080Emulator::ORA() {
-	const Registers8080 reg = m_pCpu->GetRegisterFromOpcode(m_CurrentOpcode);
-
-	const uint16_t result = m_pCpu->a | m_pCpu->ReadRegister(reg);
-	m_pCpu->a = (result & 0xFF);
-
-	m_pCpu->ConditionBits.c = false;
-	m_pCpu->UpdateFlags(m_pCpu->a);
-	m_pCpu->pc += 1;
-}
-
-//compare a register/mem value with A, update registers
-void i8080Emulator::CMP() {
-	const Registers8080 reg = m_pCpu->GetRegisterFromOpcode(m_CurrentOpcode);
-
-	const uint16_t result = m_pCpu->a - m_pCpu->ReadRegister(reg);
-	m_pCpu->ConditionBits.ac = (result ^ m_pCpu->a ^ m_pCpu->ReadRegister(reg)) & (1 << 4);
-	m_pCpu->ConditionBits.c = (result & 0xFF00) != 0;
-	m_pCpu->UpdateFlags(uint8_t(result));
-
-	m_pCpu->pc += 1;
-}
-
-//return on nonzero
-void i8080Emulator::RNZ() {
-	RETURN((m_pCpu->ConditionBits.z == false));
-}
-
-//jump to address from after m_Cpu->pc if non zero
-void i8080Emulator::JNZ() {
-	JUMP(m_pCpu->ConditionBits.z == false);
-}
-
 //normal jump
 void i8080Emulator::JMP() {
 	JUMP(true);
 }
 
-//call if not zero
-void i8080Emulator::CNZ() {
-	CALLif(m_pCpu->ConditionBits.z == false);
-}
-
 //adds a byte onto A, fetched after m_Cpu->pc
 void i8080Emulator::ADI() {
-	uint16_t sum = m_pCpu->a + m_Memory[m_pCpu->pc + 1];
+	uint16_t sum = m_pCpu->a + ReadMem(m_pCpu->pc + 1);
 	m_pCpu->a = (sum & 0xFF);
-	m_pCpu->ConditionBits.c = sum > 0xFF;
+	m_pCpu->SetCarry(sum > 0xFF);
 	m_pCpu->UpdateFlags(m_pCpu->a);
-	m_pCpu->pc += OPCODES[0xC6].sizeBytes;
-}
-
-void i8080Emulator::RST() {
-	const uint8_t address = (m_CurrentOpcode & 0b0011'1000);
-	RESTART(address);
-}
-
-//return if Z
-void i8080Emulator::RZ() {
-	RETURN(m_pCpu->ConditionBits.z);
+	m_pCpu->pc += OPCODE_INFO[0xC6].sizeBytes;
 }
 
 //return
@@ -731,16 +1378,6 @@ void i8080Emulator::RET() {
 	RETURN(true);
 }
 
-//jump if zero
-void i8080Emulator::JZ() {
-	JUMP(m_pCpu->ConditionBits.z);
-}
-
-//call if Z flag set
-void i8080Emulator::CZ() {
-	CALLif(m_pCpu->ConditionBits.z);
-}
-
 //store m_Cpu->pc on stack, and jump to a new location
 void i8080Emulator::CALL() {
 	CALLif(true);
@@ -748,26 +1385,16 @@ void i8080Emulator::CALL() {
 
 //add carry bit and Byte onto A
 void i8080Emulator::ACI() {
-	uint16_t sum = m_pCpu->a + m_Memory[m_pCpu->pc + 1] + (uint8_t)m_pCpu->ConditionBits.c;
+	uint16_t sum = m_pCpu->a + ReadMem(m_pCpu->pc + 1) + m_pCpu->Carry();
 	m_pCpu->a = (sum & 0xFF);
-	m_pCpu->ConditionBits.c = sum > 0xFF;
+	m_pCpu->SetCarry(sum > 0xFF);
 	m_pCpu->UpdateFlags(m_pCpu->a);
 	m_pCpu->pc += 2;
 }
 
-//return if Cy = 0
-void i8080Emulator::RNC() {
-	RETURN(m_pCpu->ConditionBits.c == false);
-}
-
-//jump when carry = 0
-void i8080Emulator::JNC() {
-	JUMP(m_pCpu->ConditionBits.c == false);
-}
-
 //https://computerarcheology.com/Arcade/SpaceInvaders/Hardware.html#dedicated-shift-hardware
 void i8080Emulator::OUT() {
-	uint8_t port = m_Memory[m_pCpu->pc + 1];
+	uint8_t port = ReadMem(m_pCpu->pc + 1);
 
 	if (port == 2){
 		m_pCpu->shiftOffset = m_pCpu->a & 7;
@@ -780,36 +1407,21 @@ void i8080Emulator::OUT() {
 		m_pCpu->outPort[port] = m_pCpu->a;
 	}
 
-	m_pCpu->pc += OPCODES[0xD3].sizeBytes;
-}
-
-//call on carry = false
-void i8080Emulator::CNC() {
-	CALLif((m_pCpu->ConditionBits.c == false));
+	m_pCpu->pc += OPCODE_INFO[0xD3].sizeBytes;
 }
 
 //subtract a byte from A
 void i8080Emulator::SUI() {
-	uint16_t result = m_pCpu->a - m_Memory[m_pCpu->pc + 1];
+	uint16_t result = m_pCpu->a - ReadMem(m_pCpu->pc + 1);
 	m_pCpu->a = (result & 0xFF);
-	m_pCpu->ConditionBits.c = result > 0xFF00;
+	m_pCpu->SetCarry(result > 0xFF00);
 	m_pCpu->UpdateFlags(m_pCpu->a);
 	m_pCpu->pc += 2;
 }
 
-//return if CY = 1
-void i8080Emulator::RC() {
-	RETURN(m_pCpu->ConditionBits.c);
-}
-
-//jump if cy = 1
-void i8080Emulator::JC() {
-	JUMP(m_pCpu->ConditionBits.c);
-}
-
 //https://computerarcheology.com/Arcade/SpaceInvaders/Hardware.html#inputs
 void i8080Emulator::IN() {
-	uint8_t port = m_Memory[m_pCpu->pc + 1];
+	uint8_t port = ReadMem(m_pCpu->pc + 1);
 
 	if (port == 3){
 		m_pCpu->a = uint8_t(m_pCpu->regShift >> (8 - m_pCpu->shiftOffset));
@@ -818,103 +1430,58 @@ void i8080Emulator::IN() {
 		m_pCpu->a = m_pCpu->inPort[port];
 	}
 
-	m_pCpu->pc += OPCODES[0xDB].sizeBytes;
-}
-
-//call if cy =1
-void i8080Emulator::CC() {
-	CALLif(m_pCpu->ConditionBits.c);
+	m_pCpu->pc += OPCODE_INFO[0xDB].sizeBytes;
 }
 
 //sub byte and cy from A
 void i8080Emulator::SBI() {
-	uint16_t sum = m_pCpu->a - m_Memory[m_pCpu->pc + 1] - (uint8_t)m_pCpu->ConditionBits.c;
+	uint16_t sum = m_pCpu->a - ReadMem(m_pCpu->pc + 1) - m_pCpu->Carry();
 	m_pCpu->a = (sum & 0xFF);
-	m_pCpu->ConditionBits.c = sum > 0xFF00;
+	m_pCpu->SetCarry(sum > 0xFF00);
 	m_pCpu->UpdateFlags(m_pCpu->a);
 	m_pCpu->pc += 2;
 }
 
-//return if P = 0
-void i8080Emulator::RPO() {
-	RETURN(m_pCpu->ConditionBits.p == 0);
-}
-
-//jump if p = 0
-void i8080Emulator::JPO() {
-	JUMP(m_pCpu->ConditionBits.p == 0);
-}
-
 //exchange HL and SP data
 //L <-> (SP) | H <-> (SP+1)
 void i8080Emulator::XTHL() {
-	const uint16_t stackContents = (m_Memory[m_pCpu->sp + 1] << 8) | m_Memory[m_pCpu->sp];
+	const uint16_t stackContents = (ReadMem(m_pCpu->sp + 1) << 8) | ReadMem(m_pCpu->sp);
 	MemWrite(m_pCpu->sp, m_pCpu->l);
 	MemWrite(m_pCpu->sp + 1, m_pCpu->h);
-	m_pCpu->SetRegisterPair(RegisterPairs8080::HL, stackContents);
+	m_pCpu->SetRegisterPair<RegisterPairs8080::HL>(stackContents);
 	m_pCpu->pc += 1;
 }
 
-//call if p = 0
-void i8080Emulator::CPO() {
-	CALLif(m_pCpu->ConditionBits.p == 0);
-}
-
 //bitwise AND byte with A
 void i8080Emulator::ANI() {
-	uint16_t result = m_pCpu->a & m_Memory[m_pCpu->pc + 1];
+	uint16_t result = m_pCpu->a & ReadMem(m_pCpu->pc + 1);
 	m_pCpu->a = (result & 0xFF);
 
-	m_pCpu->ConditionBits.c = result > 0xFF00;
+	m_pCpu->SetCarry(result > 0xFF00);
 	m_pCpu->UpdateFlags(m_pCpu->a);
-	m_pCpu->pc += OPCODES[0xE6].sizeBytes;
-}
-
-//return if p = 1
-void i8080Emulator::RPE() {
-	RETURN(m_pCpu->ConditionBits.p);
+	m_pCpu->pc += OPCODE_INFO[0xE6].sizeBytes;
 }
 
 //set pc to HL
 void i8080Emulator::PCHL() {
-	m_pCpu->pc = m_pCpu->ReadRegisterPair(RegisterPairs8080::HL);
-}
-
-//jump if p = 1
-void i8080Emulator::JPE() {
-	JUMP(m_pCpu->ConditionBits.p);
+	m_pCpu->pc = m_pCpu->ReadRegisterPair<RegisterPairs8080::HL>();
 }
 
 //exchange HL and DE
 void i8080Emulator::XCHG() {
-	uint16_t oldDE = m_pCpu->ReadRegisterPair(RegisterPairs8080::DE);
-	m_pCpu->SetRegisterPair(RegisterPairs8080::DE, m_pCpu->l, m_pCpu->h);//uint16_t(m_Cpu->h << 8) | m_Cpu->l);
-	m_pCpu->SetRegisterPair(RegisterPairs8080::HL, oldDE);
-	m_pCpu->pc += OPCODES[0xEB].sizeBytes;
-}
-
-//call if p = 1
-void i8080Emulator::CPE() {
-	CALLif(m_pCpu->ConditionBits.p);
+	uint16_t oldDE = m_pCpu->ReadRegisterPair<RegisterPairs8080::DE>();
+	m_pCpu->SetRegisterPair<RegisterPairs8080::DE>(m_pCpu->ReadRegisterPair<RegisterPairs8080::HL>());
+	m_pCpu->SetRegisterPair<RegisterPairs8080::HL>(oldDE);
+	m_pCpu->pc += OPCODE_INFO[0xEB].sizeBytes;
 }
 
 //XOR A with a byte
 void i8080Emulator::XRI() {
-	uint16_t sum = m_pCpu->a ^ m_Memory[m_pCpu->pc + 1];
+	uint16_t sum = m_pCpu->a ^ ReadMem(m_pCpu->pc + 1);
 	m_pCpu->a = (sum & 0xFF);
-	m_pCpu->ConditionBits.c = sum > 0xFF00;
+	m_pCpu->SetCarry(sum > 0xFF00);
 	m_pCpu->UpdateFlags(m_pCpu->a);
-	m_pCpu->pc += OPCODES[0xEE].sizeBytes;
-}
-
-//return if positive
-void i8080Emulator::RP() {
-	RETURN(m_pCpu->ConditionBits.s == false);
-}
-
-//jump if positive
-void i8080Emulator::JP() {
-	JUMP(m_pCpu->ConditionBits.s == false);
+	m_pCpu->pc += OPCODE_INFO[0xEE].sizeBytes;
 }
 
 //disable Interrupts
@@ -923,34 +1490,19 @@ void i8080Emulator::DI() {
 	m_pCpu->pc += 1;
 }
 
-//call if positive
-void i8080Emulator::CP() {
-	CALLif(m_pCpu->ConditionBits.s == false);
-}
-
 //biwise OR A with a byte
 void i8080Emulator::ORI() {
-	const uint16_t result = m_pCpu->a | m_Memory[m_pCpu->pc + 1];
+	const uint16_t result = m_pCpu->a | ReadMem(m_pCpu->pc + 1);
 	m_pCpu->a = (result & 0xFF);
-	m_pCpu->ConditionBits.c = result > 0xFF00;
+	m_pCpu->SetCarry(result > 0xFF00);
 	m_pCpu->UpdateFlags(m_pCpu->a);
 	m_pCpu->pc += 2;
 }
 
-//return if minus
-void i8080Emulator::RM() {
-	RETURN(m_pCpu->ConditionBits.s == true);
-}
-
 //sets SP to HL
 void i8080Emulator::SPHL() {
-	m_pCpu->sp = m_pCpu->ReadRegisterPair(RegisterPairs8080::HL);
-	m_pCpu->pc += OPCODES[0xF9].sizeBytes;
-}
-
-//jump if minus
-void i8080Emulator::JM() {
-	JUMP(m_pCpu->ConditionBits.s == true);
+	m_pCpu->sp = m_pCpu->ReadRegisterPair<RegisterPairs8080::HL>();
+	m_pCpu->pc += OPCODE_INFO[0xF9].sizeBytes;
 }
 
 //enable Interrrupts
@@ -959,18 +1511,13 @@ void i8080Emulator::EI() {
 	m_pCpu->pc += 1;
 }
 
-//call if minus
-void i8080Emulator::CM() {
-	CALLif(m_pCpu->ConditionBits.s == true);
-}
-
 //ComPare Immediate with Accumulator
 //See page 29 8080-Programmers-Manual
 void i8080Emulator::CPI() {
-	const uint8_t result = m_pCpu->a - m_Memory[m_pCpu->pc + 1];
-	m_pCpu->ConditionBits.c = m_pCpu->a < m_Memory[m_pCpu->pc + 1];
+	const uint8_t result = m_pCpu->a - ReadMem(m_pCpu->pc + 1);
+	m_pCpu->SetCarry(m_pCpu->a < ReadMem(m_pCpu->pc + 1));
 	m_pCpu->UpdateFlags(result);
-	m_pCpu->pc += OPCODES[0xFE].sizeBytes;
+	m_pCpu->pc += OPCODE_INFO[0xFE].sizeBytes;
 }
 
 #pragma endregion OpcodeFunctions
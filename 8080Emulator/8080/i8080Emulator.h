@@ -1,17 +1,29 @@
 #pragma once
-#include <chrono>
+#include <array>
+#include <cstdint>
+#include <functional>
 #include <iostream>
+#include <utility>
+#include <vector>
+
+#include "Memory.h"
 
 class Keyboard;
 class Display;
 class CPU;
+class FramePacer;
+class InterruptController;
+class Scheduler;
+struct SaveStateHeader;
+enum class Registers8080;
+enum class RegisterPairs8080;
+enum class Condition8080;
 
 class i8080Emulator
 {
 	void defaultOpcode();
-	struct Opcode
+	struct OpcodeInfo
 	{
-		void (i8080Emulator::* opcode)() { &i8080Emulator::defaultOpcode};
 		const char* mnemonic;
 		unsigned char sizeBytes;
 	};
@@ -28,68 +40,201 @@ public:
 
 	bool LoadRom(bool consoleProgram, const char* path);
 
+	//runs up to the next device event, then waits until it's due in real time (ROMs only, see FramePacer)
 	void Update();
 	void Stop();
 
+	//Executes a single instruction without throttling or device updates
+	//returns the amount of clock cycles it took (0 when halted)
+	uint8_t Step();
+	//true once the program stopped, a CPU waiting in HLT for an interrupt isn't halted
+	bool IsHalted() const;
+
+	//Batch execution, unthrottled
+	//instructions run in a tight loop until the next scheduled device event
+	//the display interrupts and keyboard are serviced in between at exact cycle positions
+	//all of these return the amount of clock cycles that were executed
+	//stopAtFrame also returns at the end of the current frame, where RunFrame would stop
+	uint64_t RunCycles(uint64_t cycles, bool stopAtFrame = false);
+	uint64_t RunInstructions(uint64_t instructions, bool stopAtFrame = false);
+	uint64_t RunUntilNextEvent();
+	uint64_t RunFrame();
+
+	//Save states (see SaveState.h)
+	//only the RAM and VRAM pages are stored, loading needs the same ROM to be loaded
+	//only call these in between batches (not from a fault callback)
+	//state is overwritten, its capacity is reused so snapshotting every frame doesn't allocate
+	void SaveState(std::vector<uint8_t>& state) const;
+	//false if the state is invalid or from a different ROM, nothing is changed then
+	bool LoadState(const uint8_t* state, size_t size);
+	bool LoadState(const std::vector<uint8_t>& state) { return LoadState(state.data(), state.size()); }
+	//identifies the loaded ROM image
+	uint64_t GetRomHash() const { return m_RomHash; }
+	//shows a state that was just loaded without running up to the next frame
+	void RedrawDisplay();
+
+	//Copy-on-write clone, owned by the caller
+	//it continues from exactly this state, the memory pages are shared by both until one of them writes to a page
+	//the ROM is never written so it stays shared, a clone only costs the pages it (or this) writes to afterwards
+	//the input hook, the display callback and the pacing mode aren't cloned, only call in between batches
+	i8080Emulator* Clone();
+
+	uint64_t GetClockCount() const;
+	uint64_t GetInstructionCount() const { return m_InstructionCount; }
+	uint64_t GetFrameCount() const { return m_HalfFrameCount >> 1; }
+
+	//Idle skipping
+	//wait loops that can't change anything until the next interrupt, and HLT, are not interpreted
+	//the clock is moved forward to the end of the batch instead
+	void SetIdleSkipping(bool enabled) { m_IdleSkipping = enabled; }
+	bool GetIdleSkipping() const { return m_IdleSkipping; }
+	uint64_t GetSkippedCycles() const { return m_SkippedCycles; }
+
+	//Input, the keyboard is written to the input ports once per frame at fixed cycles (see Scheduler)
+	//a hook replaces that poll, cycle is when the poll was due, movies record and replay the ports through it (see Movie.h)
+	using InputHook = std::function<void(uint64_t cycle, uint8_t* inPort)>;
+	void SetInputHook(InputHook hook) { m_InputHook = std::move(hook); }
+
+	//requests RST 1 (ID 0) or RST 2 (ID 1), it's latched until interrupts are enabled
 	void Interrupt(uint8_t ID);
 
-	void MemWrite(uint16_t address, uint8_t data);
-	uint8_t ReadMem(uint16_t address);
+	void MemWrite(uint16_t address, uint8_t data) { m_Memory.Write(address, data); }
+	uint8_t ReadMem(uint16_t address) const { return m_Memory.Read(address); }
+	Memory& GetMemory() { return m_Memory; }
+	//copies the VRAM pages that are still shared with a clone
+	const uint8_t* GetVRAM() { return m_Memory.GetStorage(stack_start, mirror_size - stack_start); }
+
+	bool IsConsoleProgram() const { return m_ConsoleProg; }
 
 	Display* GetDisplay() const {return m_pDisplay;}
 	Keyboard* GetKeyboard() const {return m_pKeyboard;}
 
-	void SetClockSpeed(uint64_t clocksPerMs) { m_ClocksPerMs = clocksPerMs; }
-	uint64_t GetClockSpeed() const { return m_ClocksPerMs; }
+	FramePacer* GetPacer() const { return m_pPacer; }
+	//clock cycles per second in real time, 2 MHz by default
+	void SetClockSpeed(uint64_t hz);
+	uint64_t GetClockSpeed() const;
 
 	//Debug
 	void PrintDisassembledRom() const;
 
 private:
-	void ThrottleCPU(uint64_t currentTime);
 	void CycleCpu();
+	void Dispatch(uint8_t opcode);
+	void ExecuteBatch(uint64_t endCycle);
+	//services every scheduled event that is due at the current clock count
+	void ServiceEvents();
+	void HalfFrame();
+	//accepts a pending interrupt if interrupts are enabled, only called in between batches
+	void ServiceInterrupts();
+	//end of the next batch, the next event or earlier while an interrupt is waiting for EI
+	uint64_t BatchEnd(uint64_t limit) const;
+	//called on short backward jumps, fast-forwards when the loop is found spinning
+	void DetectIdleLoop(uint16_t loopStart);
+	bool IsIdleLoopBody(uint16_t loopStart, uint16_t loopEnd, uint64_t& iterationCycles) const;
+	//everything in a save state but the memory
+	void WriteStateHeader(SaveStateHeader& header) const;
+	void ReadStateHeader(const SaveStateHeader& header);
 	void Syscall(uint16_t ID);
+	void MapMemory();
 
 	bool m_ConsoleProg;
 
 	CPU* m_pCpu;
-	uint8_t* m_Memory;
+	Memory m_Memory;
 	int64_t m_CurrRomSize;
 	uint16_t m_ProgramStart = 0x0000;
+	uint64_t m_RomHash{};
 
 	uint8_t m_CurrentOpcode;
 
 
-	uint64_t m_ClocksPerMs;
-	std::chrono::time_point<std::chrono::steady_clock> m_StartTime{};
-	uint64_t m_LastThrottle{};
+	FramePacer* m_pPacer;
+
+	//batch execution state
+	Scheduler* m_pScheduler;
+	InterruptController* m_pInterrupts;
+	uint64_t m_HalfFrameCount{};
+	uint64_t m_InstructionCount{};
+	uint64_t m_BatchEnd{}; //end cycle of the running batch, 0 outside of a batch
+
+	//last short backward jump, a wait loop is detected when an iteration leaves everything as it was
+	struct IdleLoop
+	{
+		uint16_t start{};
+		uint16_t end{}; //address of the jump back to start
+		uint64_t iterationCycles{}; //0 if the loop body can change memory or I/O
+		uint64_t clockCount{};
+		uint8_t registers[8]{};
+		uint16_t sp{};
+		uint8_t flags{};
+	};
+	IdleLoop m_IdleLoop{};
+	bool m_IdleSkipping{ true };
+	uint64_t m_SkippedCycles{};
 
 	Display* m_pDisplay;
 	Keyboard* m_pKeyboard;
+	InputHook m_InputHook{ nullptr };
 
 	//http://www.computerarcheology.com/Arcade/SpaceInvaders/RAMUse.html
-	static constexpr int memory_size = 0x10000;
 	static constexpr int rom_size = 0x2000;
-	static constexpr int stack_start = 0x2400;
+	static constexpr int stack_start = 0x2400; //also the start of VRAM
+	static constexpr int mirror_size = 0x4000;
+
+	//2 MHz at 60 Hz, the display interrupts at the middle and at the end of every frame
+	static constexpr uint64_t cycles_per_frame = 2'000'000 / 60;
+	static constexpr uint64_t cycles_per_half_frame = cycles_per_frame / 2;
+	//inputs are sampled once per frame, together with the VBlank interrupt
+	static constexpr uint64_t cycles_per_keyboard_poll = cycles_per_half_frame * 2;
+	//how often a masked interrupt request is retried
+	static constexpr uint64_t interrupt_retry_cycles = 1'000;
+	//an accepted interrupt executes the RST put on the bus
+	static constexpr uint8_t interrupt_acknowledge_cycles = 11;
+	//longest backward jump that's checked for a wait loop
+	static constexpr uint16_t idle_loop_max_bytes = 16;
 
 
 #pragma region OpcodeFunctions
 
+	//every opcode compiles to its own handler, operands are decoded from the opcode at compile time
+	template<uint8_t Opcode>
+	void Execute();
+
+	//memory reference M goes through memory, all other registers are read straight from the CPU
+	template<Registers8080 Reg>
+	uint8_t ReadOperand();
+	template<Registers8080 Reg>
+	void WriteOperand(uint8_t value);
+
 #pragma region GenericOpcodeFunctions
 	//Generic functions
 	void RETURN(bool);
 	void RESTART(uint16_t);
 	void CALLif(bool);
 	void JUMP(bool);
-	void POP();
-	void DCX();
-	void DAD();
-	void DCR();
-	void MVI();
-	void PUSH();
-	void LXI();
-	void INX();
-	void INR();
+
+	template<RegisterPairs8080 Pair> void POP();
+	template<RegisterPairs8080 Pair> void DCX();
+	template<RegisterPairs8080 Pair> void DAD();
+	template<RegisterPairs8080 Pair> void PUSH();
+	template<RegisterPairs8080 Pair> void LXI();
+	template<RegisterPairs8080 Pair> void INX();
+	template<Registers8080 Reg> void DCR();
+	template<Registers8080 Reg> void MVI();
+	template<Registers8080 Reg> void INR();
+	template<Registers8080 Dst, Registers8080 Src> void MOV();
+	template<Registers8080 Reg> void ADD();
+	template<Registers8080 Reg> void ADC();
+	template<Registers8080 Reg> void SUB();
+	template<Registers8080 Reg> void SBB();
+	template<Registers8080 Reg> void ANA();
+	template<Registers8080 Reg> void XRA();
+	template<Registers8080 Reg> void ORA();
+	template<Registers8080 Reg> void CMP();
+	template<Condition8080 Cond> void Rcc();
+	template<Condition8080 Cond> void Jcc();
+	template<Condition8080 Cond> void Ccc();
+	template<uint8_t Vector> void RST();
 #pragma endregion GenericOpcodeFunctions
 
 	void NOP();
@@ -109,323 +254,296 @@ private:
 	void STC();
 	void LDA();
 	void CMC();
-	void MOV();
 	void HLT();
-	void ADD();
-	void ADC();
-	void SUB();
-	void SBB();
-	void ANA();
-	void XRA();
-	void ORA();
-	void CMP();
-	void RNZ();
-	void JNZ();
 	void JMP();
-	void CNZ();
 	void ADI();
-	void RST();
-	void RZ();
 	void RET();
-	void JZ();
-	void CZ();
 	void CALL();
 	void ACI();
-	void RNC();
-	void JNC();
 	void OUT();
-	void CNC();
 	void SUI();
-	void RC();
-	void JC();
 	void IN();
-	void CC();
 	void SBI();
-	void RPO();
-	void JPO();
 	void XTHL();
-	void CPO();
 	void ANI();
-	void RPE();
 	void PCHL();
-	void JPE();
 	void XCHG();
-	void CPE();
 	void XRI();
-	void RP();
-	void JP();
 	void DI();
-	void CP();
 	void ORI();
-	void RM();
 	void SPHL();
-	void JM();
 	void EI();
-	void CM();
 	void CPI();
 
 #pragma endregion OpcodeFunctions
 
-	//wrote the opcode functions myself
+	//hot handler table, only used by the TABLE dispatch core
+	//generated from Execute<0x00> ... Execute<0xFF> (see i8080Emulator.cpp)
+	using OpcodeHandler = void (i8080Emulator::*)();
+	template<size_t... Opcodes>
+	static constexpr std::array<OpcodeHandler, 256> MakeOpcodeHandlers(std::index_sequence<Opcodes...>);
+	static const std::array<OpcodeHandler, 256> OPCODE_HANDLERS;
+
+	//cold disassembly metadata, kept out of the dispatch path
 	//copied name and size of opcodes from https://github.com/mlima/8080/blob/master/disassemble.cpp
-	static constexpr Opcode OPCODES[256]
+	static constexpr OpcodeInfo OPCODE_INFO[256]
 	{
-	{ &i8080Emulator::NOP,"NOP", 1 },
-	{ &i8080Emulator::LXI,"LXI B", 3 },
-	{ &i8080Emulator::STAXB,"STAX B", 1 },
-	{ &i8080Emulator::INX,"INX B", 1 },
-	{ &i8080Emulator::INR,"INR B", 1 },
-	{ &i8080Emulator::DCR,"DCR B", 1 },
-	{ &i8080Emulator::MVI,"MVI B", 2 },
-	{ &i8080Emulator::RLC,"RLC", 1 },
-	{ &i8080Emulator::defaultOpcode,"", 1 },
-	{ &i8080Emulator::DAD,"DAD B", 1 },
-	{ &i8080Emulator::LDAXB,"LDAX B", 1 },
-	{ &i8080Emulator::DCX,"DCX B", 1 },
-	{ &i8080Emulator::INR,"INR C", 1 },
-	{ &i8080Emulator::DCR,"DCR C", 1 },
-	{ &i8080Emulator::MVI,"MVI C", 2 },
-	{ &i8080Emulator::RRC,"RRC", 1 },
-	{ &i8080Emulator::defaultOpcode,"", 1 },
-	{ &i8080Emulator::LXI,"LXI D", 3 },
-	{ &i8080Emulator::STAXD,"STAX D", 1 },
-	{ &i8080Emulator::INX,"INX D", 1 },
-	{ &i8080Emulator::INR,"INR D", 1 },
-	{ &i8080Emulator::DCR,"DCR D", 1 },
-	{ &i8080Emulator::MVI,"MVI D", 2 },
-	{ &i8080Emulator::RAL,"RAL", 1 },
-	{ &i8080Emulator::defaultOpcode,"", 1 },
-	{ &i8080Emulator::DAD,"DAD D", 1 },
-	{ &i8080Emulator::LDAXD,"LDAX D", 1 },
-	{ &i8080Emulator::DCX,"DCX D", 1 },
-	{ &i8080Emulator::INR,"INR E", 1 },
-	{ &i8080Emulator::DCR,"DCR E", 1 },
-	{ &i8080Emulator::MVI,"MVI E", 2 },
-	{ &i8080Emulator::RAR,"RAR", 1 },
-	{ &i8080Emulator::defaultOpcode,"", 1 },
-	{ &i8080Emulator::LXI,"LXI H", 3 },
-	{ &i8080Emulator::SHLD,"SHLD", 3 },
-	{ &i8080Emulator::INX,"INX H", 1 },
-	{ &i8080Emulator::INR,"INR H", 1 },
-	{ &i8080Emulator::DCR,"DCR H", 1 },
-	{ &i8080Emulator::MVI,"MVI H", 2 },
-	{ &i8080Emulator::DAA,"DAA", 1 },
-	{ &i8080Emulator::defaultOpcode,"", 1 },
-	{ &i8080Emulator::DAD,"DAD H", 1 },
-	{ &i8080Emulator::LHLD,"LHLD", 3 },
-	{ &i8080Emulator::DCX,"DCX H", 1 },
-	{ &i8080Emulator::INR,"INR L", 1 },
-	{ &i8080Emulator::DCR,"DCR L", 1 },
-	{ &i8080Emulator::MVI,"MVI L", 2 },
-	{ &i8080Emulator::CMA,"CMA", 1 },
-	{ &i8080Emulator::defaultOpcode,"", 1 },
-	{ &i8080Emulator::LXI,"LXI SP", 3 },
-	{ &i8080Emulator::STA,"STA", 3 },
-	{ &i8080Emulator::INX,"INX SP", 1 },
-	{ &i8080Emulator::INR,"INR M", 1 },
-	{ &i8080Emulator::DCR,"DCR M", 1 },
-	{ &i8080Emulator::MVI,"MVI M", 2 },
-	{ &i8080Emulator::STC,"STC", 1 },
-	{ &i8080Emulator::defaultOpcode,"", 1 },
-	{ &i8080Emulator::DAD,"DAD SP", 1 },
-	{ &i8080Emulator::LDA,"LDA", 3 },
-	{ &i8080Emulator::DCX,"DCX SP", 1 },
-	{ &i8080Emulator::INR,"INR A", 1 },
-	{ &i8080Emulator::DCR,"DCR A", 1 },
-	{ &i8080Emulator::MVI,"MVI A", 2 },
-	{ &i8080Emulator::CMC,"CMC", 1 },
-	{ &i8080Emulator::MOV, "MOV B,B", 1 },
-	{ &i8080Emulator::MOV, "MOV B,C", 1 },
-	{ &i8080Emulator::MOV, "MOV B,D", 1 },
-	{ &i8080Emulator::MOV, "MOV B,E", 1 },
-	{ &i8080Emulator::MOV, "MOV B,H", 1 },
-	{ &i8080Emulator::MOV, "MOV B,L", 1 },
-	{ &i8080Emulator::MOV, "MOV B,M", 1 },
-	{ &i8080Emulator::MOV, "MOV B,A", 1 },
-	{ &i8080Emulator::MOV, "MOV C,B", 1 },
-	{ &i8080Emulator::MOV, "MOV C,C", 1 },
-	{ &i8080Emulator::MOV, "MOV C,D", 1 },
-	{ &i8080Emulator::MOV, "MOV C,E", 1 },
-	{ &i8080Emulator::MOV, "MOV C,H", 1 },
-	{ &i8080Emulator::MOV, "MOV C,L", 1 },
-	{ &i8080Emulator::MOV, "MOV C,M", 1 },
-	{ &i8080Emulator::MOV, "MOV C,A", 1 },
-	{ &i8080Emulator::MOV, "MOV D,B", 1 },
-	{ &i8080Emulator::MOV, "MOV D,C", 1 },
-	{ &i8080Emulator::MOV, "MOV D,D", 1 },
-	{ &i8080Emulator::MOV, "MOV D,E", 1 },
-	{ &i8080Emulator::MOV, "MOV D,H", 1 },
-	{ &i8080Emulator::MOV, "MOV D,L", 1 },
-	{ &i8080Emulator::MOV, "MOV D,M", 1 },
-	{ &i8080Emulator::MOV, "MOV D,A", 1 },
-	{ &i8080Emulator::MOV, "MOV E,B", 1 },
-	{ &i8080Emulator::MOV, "MOV E,C", 1 },
-	{ &i8080Emulator::MOV, "MOV E,D", 1 },
-	{ &i8080Emulator::MOV, "MOV E,E", 1 },
-	{ &i8080Emulator::MOV, "MOV E,H", 1 },
-	{ &i8080Emulator::MOV, "MOV E,L", 1 },
-	{ &i8080Emulator::MOV, "MOV E,M", 1 },
-	{ &i8080Emulator::MOV, "MOV E,A", 1 },
-	{ &i8080Emulator::MOV, "MOV H,B", 1 },
-	{ &i8080Emulator::MOV, "MOV H,C", 1 },
-	{ &i8080Emulator::MOV, "MOV H,D", 1 },
-	{ &i8080Emulator::MOV, "MOV H,E", 1 },
-	{ &i8080Emulator::MOV, "MOV H,H", 1 },
-	{ &i8080Emulator::MOV, "MOV H,L", 1 },
-	{ &i8080Emulator::MOV, "MOV H,M", 1 },
-	{ &i8080Emulator::MOV, "MOV H,A", 1 },
-	{ &i8080Emulator::MOV, "MOV L,B", 1 },
-	{ &i8080Emulator::MOV, "MOV L,C", 1 },
-	{ &i8080Emulator::MOV, "MOV L,D", 1 },
-	{ &i8080Emulator::MOV, "MOV L,E", 1 },
-	{ &i8080Emulator::MOV, "MOV L,H", 1 },
-	{ &i8080Emulator::MOV, "MOV L,L", 1 },
-	{ &i8080Emulator::MOV, "MOV L,M", 1 },
-	{ &i8080Emulator::MOV, "MOV L,A", 1 },
-	{ &i8080Emulator::MOV, "MOV M,B", 1 },
-	{ &i8080Emulator::MOV, "MOV M,C", 1 },
-	{ &i8080Emulator::MOV, "MOV M,D", 1 },
-	{ &i8080Emulator::MOV, "MOV M,E", 1 },
-	{ &i8080Emulator::MOV, "MOV M,H", 1 },
-	{ &i8080Emulator::MOV, "MOV M,L", 1 },
-	{ &i8080Emulator::HLT,"HLT", 1 },
-	{ &i8080Emulator::MOV,"MOV M,A", 1 },
-	{ &i8080Emulator::MOV,"MOV A,B", 1 },
-	{ &i8080Emulator::MOV,"MOV A,C", 1 },
-	{ &i8080Emulator::MOV,"MOV A,D", 1 },
-	{ &i8080Emulator::MOV,"MOV A,E", 1 },
-	{ &i8080Emulator::MOV,"MOV A,H", 1 },
-	{ &i8080Emulator::MOV,"MOV A,L", 1 },
-	{ &i8080Emulator::MOV,"MOV A,M", 1 },
-	{ &i8080Emulator::MOV,"MOV A,A", 1 },
-	{ &i8080Emulator::ADD,"ADD B", 1 },
-	{ &i8080Emulator::ADD,"ADD C", 1 },
-	{ &i8080Emulator::ADD,"ADD D", 1 },
-	{ &i8080Emulator::ADD,"ADD E", 1 },
-	{ &i8080Emulator::ADD,"ADD H", 1 },
-	{ &i8080Emulator::ADD,"ADD L", 1 },
-	{ &i8080Emulator::ADD,"ADD M", 1 },
-	{ &i8080Emulator::ADD,"ADD A", 1 },
-	{ &i8080Emulator::ADC,"ADC B", 1 },
-	{ &i8080Emulator::ADC,"ADC C", 1 },
-	{ &i8080Emulator::ADC,"ADC D", 1 },
-	{ &i8080Emulator::ADC,"ADC E", 1 },
-	{ &i8080Emulator::ADC,"ADC H", 1 },
-	{ &i8080Emulator::ADC,"ADC L", 1 },
-	{ &i8080Emulator::ADC,"ADC M", 1 },
-	{ &i8080Emulator::ADC,"ADC A", 1 },
-	{ &i8080Emulator::SUB,"SUB B", 1 },
-	{ &i8080Emulator::SUB,"SUB C", 1 },
-	{ &i8080Emulator::SUB,"SUB D", 1 },
-	{ &i8080Emulator::SUB,"SUB E", 1 },
-	{ &i8080Emulator::SUB,"SUB H", 1 },
-	{ &i8080Emulator::SUB,"SUB L", 1 },
-	{ &i8080Emulator::SUB,"SUB M", 1 },
-	{ &i8080Emulator::SUB,"SUB A", 1 },
-	{ &i8080Emulator::SBB,"SBB B", 1 },
-	{ &i8080Emulator::SBB,"SBB C", 1 },
-	{ &i8080Emulator::SBB,"SBB D", 1 },
-	{ &i8080Emulator::SBB,"SBB E", 1 },
-	{ &i8080Emulator::SBB,"SBB H", 1 },
-	{ &i8080Emulator::SBB,"SBB L", 1 },
-	{ &i8080Emulator::SBB,"SBB M", 1 },
-	{ &i8080Emulator::SBB,"SBB A", 1 },
-	{ &i8080Emulator::ANA,"ANA B", 1 },
-	{ &i8080Emulator::ANA,"ANA C", 1 },
-	{ &i8080Emulator::ANA,"ANA D", 1 },
-	{ &i8080Emulator::ANA,"ANA E", 1 },
-	{ &i8080Emulator::ANA,"ANA H", 1 },
-	{ &i8080Emulator::ANA,"ANA L", 1 },
-	{ &i8080Emulator::ANA,"ANA M", 1 },
-	{ &i8080Emulator::ANA,"ANA A", 1 },
-	{ &i8080Emulator::XRA,"XRA B", 1 },
-	{ &i8080Emulator::XRA,"XRA C", 1 },
-	{ &i8080Emulator::XRA,"XRA D", 1 },
-	{ &i8080Emulator::XRA,"XRA E", 1 },
-	{ &i8080Emulator::XRA,"XRA H", 1 },
-	{ &i8080Emulator::XRA,"XRA L", 1 },
-	{ &i8080Emulator::XRA,"XRA M", 1 },
-	{ &i8080Emulator::XRA,"XRA A", 1 },
-	{ &i8080Emulator::ORA,"ORA B", 1 },
-	{ &i8080Emulator::ORA,"ORA C", 1 },
-	{ &i8080Emulator::ORA,"ORA D", 1 },
-	{ &i8080Emulator::ORA,"ORA E", 1 },
-	{ &i8080Emulator::ORA,"ORA H", 1 },
-	{ &i8080Emulator::ORA,"ORA L", 1 },
-	{ &i8080Emulator::ORA,"ORA M", 1 },
-	{ &i8080Emulator::ORA,"ORA A", 1 },
-	{ &i8080Emulator::CMP,"CMP B", 1 },
-	{ &i8080Emulator::CMP,"CMP C", 1 },
-	{ &i8080Emulator::CMP,"CMP D", 1 },
-	{ &i8080Emulator::CMP,"CMP E", 1 },
-	{ &i8080Emulator::CMP,"CMP H", 1 },
-	{ &i8080Emulator::CMP,"CMP L", 1 },
-	{ &i8080Emulator::CMP,"CMP M", 1 },
-	{ &i8080Emulator::CMP,"CMP A", 1 },
-	{ &i8080Emulator::RNZ,"RNZ", 1 },
-	{ &i8080Emulator::POP,"POP B", 1 },
-	{ &i8080Emulator::JNZ,"JNZ", 3 },
-	{ &i8080Emulator::JMP,"JMP", 3 },
-	{ &i8080Emulator::CNZ,"CNZ", 3 },
-	{ &i8080Emulator::PUSH,"PUSH B", 1 },
-	{ &i8080Emulator::ADI,"ADI", 2 },
-	{ &i8080Emulator::RST,"RST 0", 1 },
-	{ &i8080Emulator::RZ,"RZ", 1 },
-	{ &i8080Emulator::RET,"RET", 1 },
-	{ &i8080Emulator::JZ,"JZ", 3 },
-	{ &i8080Emulator::defaultOpcode,"", 1 },
-	{ &i8080Emulator::CZ,"CZ", 3 },
-	{ &i8080Emulator::CALL,"CALL", 3 },
-	{ &i8080Emulator::ACI,"ACI", 2 },
-	{ &i8080Emulator::RST,"RST1", 1 },
-	{ &i8080Emulator::RNC,"RNC", 1 },
-	{ &i8080Emulator::POP,"POP D", 1 },
-	{ &i8080Emulator::JNC,"JNC", 3 },
-	{ &i8080Emulator::OUT,"OUT", 2 },
-	{ &i8080Emulator::CNC,"CNC", 3 },
-	{ &i8080Emulator::PUSH,"PUSH D", 1 },
-	{ &i8080Emulator::SUI,"SUI", 2 },
-	{ &i8080Emulator::RST,"RST 2", 1 },
-	{ &i8080Emulator::RC,"RC", 1 },
-	{ &i8080Emulator::defaultOpcode,"", 1 },
-	{ &i8080Emulator::JC,"JC", 3 },
-	{ &i8080Emulator::IN,"IN D8", 2 },
-	{ &i8080Emulator::CC,"CC", 3 },
-	{ &i8080Emulator::defaultOpcode,"", 1 },
-	{ &i8080Emulator::SBI,"SBI", 2 },
-	{ &i8080Emulator::RST,"RST 3", 1 },
-	{ &i8080Emulator::RPO,"RPO", 1 },
-	{ &i8080Emulator::POP,"POP H", 1 },
-	{ &i8080Emulator::JPO,"JPO", 3 },
-	{ &i8080Emulator::XTHL,"XTHL", 1 },
-	{ &i8080Emulator::CPO,"CPO", 3 },
-	{ &i8080Emulator::PUSH,"PUSH H", 1 },
-	{ &i8080Emulator::ANI,"ANI", 2 },
-	{ &i8080Emulator::RST,"RST 4", 1 },
-	{ &i8080Emulator::RPE,"RPE", 1 },
-	{ &i8080Emulator::PCHL,"PCHL", 1 },
-	{ &i8080Emulator::JPE,"JPE", 3 },
-	{ &i8080Emulator::XCHG,"XCHG", 1 },
-	{ &i8080Emulator::CPE,"CPE", 3 },
-	{ &i8080Emulator::defaultOpcode,"", 1 },
-	{ &i8080Emulator::XRI,"XRI", 2 },
-	{ &i8080Emulator::RST,"RST 5", 1 },
-	{ &i8080Emulator::RP,"RP", 1 },
-	{ &i8080Emulator::POP,"POP PSW", 1 },
-	{ &i8080Emulator::JP,"JP", 3 },
-	{ &i8080Emulator::DI,"DI", 1 },
-	{ &i8080Emulator::CP,"CP", 3 },
-	{ &i8080Emulator::PUSH,"PUSH PSW", 1 },
-	{ &i8080Emulator::ORI,"ORI", 2 },
-	{ &i8080Emulator::RST,"RST 6", 1 },
-	{ &i8080Emulator::RM,"RM", 1 },
-	{ &i8080Emulator::SPHL,"SPHL", 1 },
-	{ &i8080Emulator::JM,"JM", 3 },
-	{ &i8080Emulator::EI,"EI", 1 },
-	{ &i8080Emulator::CM,"CM", 3 },
-	{ &i8080Emulator::defaultOpcode,"", 1 },
-	{ &i8080Emulator::CPI,"CPI", 2 },
-	{ &i8080Emulator::RST,"RST 7", 1 }
+	{ "NOP", 1 },
+	{ "LXI B", 3 },
+	{ "STAX B", 1 },
+	{ "INX B", 1 },
+	{ "INR B", 1 },
+	{ "DCR B", 1 },
+	{ "MVI B", 2 },
+	{ "RLC", 1 },
+	{ "", 1 },
+	{ "DAD B", 1 },
+	{ "LDAX B", 1 },
+	{ "DCX B", 1 },
+	{ "INR C", 1 },
+	{ "DCR C", 1 },
+	{ "MVI C", 2 },
+	{ "RRC", 1 },
+	{ "", 1 },
+	{ "LXI D", 3 },
+	{ "STAX D", 1 },
+	{ "INX D", 1 },
+	{ "INR D", 1 },
+	{ "DCR D", 1 },
+	{ "MVI D", 2 },
+	{ "RAL", 1 },
+	{ "", 1 },
+	{ "DAD D", 1 },
+	{ "LDAX D", 1 },
+	{ "DCX D", 1 },
+	{ "INR E", 1 },
+	{ "DCR E", 1 },
+	{ "MVI E", 2 },
+	{ "RAR", 1 },
+	{ "", 1 },
+	{ "LXI H", 3 },
+	{ "SHLD", 3 },
+	{ "INX H", 1 },
+	{ "INR H", 1 },
+	{ "DCR H", 1 },
+	{ "MVI H", 2 },
+	{ "DAA", 1 },
+	{ "", 1 },
+	{ "DAD H", 1 },
+	{ "LHLD", 3 },
+	{ "DCX H", 1 },
+	{ "INR L", 1 },
+	{ "DCR L", 1 },
+	{ "MVI L", 2 },
+	{ "CMA", 1 },
+	{ "", 1 },
+	{ "LXI SP", 3 },
+	{ "STA", 3 },
+	{ "INX SP", 1 },
+	{ "INR M", 1 },
+	{ "DCR M", 1 },
+	{ "MVI M", 2 },
+	{ "STC", 1 },
+	{ "", 1 },
+	{ "DAD SP", 1 },
+	{ "LDA", 3 },
+	{ "DCX SP", 1 },
+	{ "INR A", 1 },
+	{ "DCR A", 1 },
+	{ "MVI A", 2 },
+	{ "CMC", 1 },
+	{ "MOV B,B", 1 },
+	{ "MOV B,C", 1 },
+	{ "MOV B,D", 1 },
+	{ "MOV B,E", 1 },
+	{ "MOV B,H", 1 },
+	{ "MOV B,L", 1 },
+	{ "MOV B,M", 1 },
+	{ "MOV B,A", 1 },
+	{ "MOV C,B", 1 },
+	{ "MOV C,C", 1 },
+	{ "MOV C,D", 1 },
+	{ "MOV C,E", 1 },
+	{ "MOV C,H", 1 },
+	{ "MOV C,L", 1 },
+	{ "MOV C,M", 1 },
+	{ "MOV C,A", 1 },
+	{ "MOV D,B", 1 },
+	{ "MOV D,C", 1 },
+	{ "MOV D,D", 1 },
+	{ "MOV D,E", 1 },
+	{ "MOV D,H", 1 },
+	{ "MOV D,L", 1 },
+	{ "MOV D,M", 1 },
+	{ "MOV D,A", 1 },
+	{ "MOV E,B", 1 },
+	{ "MOV E,C", 1 },
+	{ "MOV E,D", 1 },
+	{ "MOV E,E", 1 },
+	{ "MOV E,H", 1 },
+	{ "MOV E,L", 1 },
+	{ "MOV E,M", 1 },
+	{ "MOV E,A", 1 },
+	{ "MOV H,B", 1 },
+	{ "MOV H,C", 1 },
+	{ "MOV H,D", 1 },
+	{ "MOV H,E", 1 },
+	{ "MOV H,H", 1 },
+	{ "MOV H,L", 1 },
+	{ "MOV H,M", 1 },
+	{ "MOV H,A", 1 },
+	{ "MOV L,B", 1 },
+	{ "MOV L,C", 1 },
+	{ "MOV L,D", 1 },
+	{ "MOV L,E", 1 },
+	{ "MOV L,H", 1 },
+	{ "MOV L,L", 1 },
+	{ "MOV L,M", 1 },
+	{ "MOV L,A", 1 },
+	{ "MOV M,B", 1 },
+	{ "MOV M,C", 1 },
+	{ "MOV M,D", 1 },
+	{ "MOV M,E", 1 },
+	{ "MOV M,H", 1 },
+	{ "MOV M,L", 1 },
+	{ "HLT", 1 },
+	{ "MOV M,A", 1 },
+	{ "MOV A,B", 1 },
+	{ "MOV A,C", 1 },
+	{ "MOV A,D", 1 },
+	{ "MOV A,E", 1 },
+	{ "MOV A,H", 1 },
+	{ "MOV A,L", 1 },
+	{ "MOV A,M", 1 },
+	{ "MOV A,A", 1 },
+	{ "ADD B", 1 },
+	{ "ADD C", 1 },
+	{ "ADD D", 1 },
+	{ "ADD E", 1 },
+	{ "ADD H", 1 },
+	{ "ADD L", 1 },
+	{ "ADD M", 1 },
+	{ "ADD A", 1 },
+	{ "ADC B", 1 },
+	{ "ADC C", 1 },
+	{ "ADC D", 1 },
+	{ "ADC E", 1 },
+	{ "ADC H", 1 },
+	{ "ADC L", 1 },
+	{ "ADC M", 1 },
+	{ "ADC A", 1 },
+	{ "SUB B", 1 },
+	{ "SUB C", 1 },
+	{ "SUB D", 1 },
+	{ "SUB E", 1 },
+	{ "SUB H", 1 },
+	{ "SUB L", 1 },
+	{ "SUB M", 1 },
+	{ "SUB A", 1 },
+	{ "SBB B", 1 },
+	{ "SBB C", 1 },
+	{ "SBB D", 1 },
+	{ "SBB E", 1 },
+	{ "SBB H", 1 },
+	{ "SBB L", 1 },
+	{ "SBB M", 1 },
+	{ "SBB A", 1 },
+	{ "ANA B", 1 },
+	{ "ANA C", 1 },
+	{ "ANA D", 1 },
+	{ "ANA E", 1 },
+	{ "ANA H", 1 },
+	{ "ANA L", 1 },
+	{ "ANA M", 1 },
+	{ "ANA A", 1 },
+	{ "XRA B", 1 },
+	{ "XRA C", 1 },
+	{ "XRA D", 1 },
+	{ "XRA E", 1 },
+	{ "XRA H", 1 },
+	{ "XRA L", 1 },
+	{ "XRA M", 1 },
+	{ "XRA A", 1 },
+	{ "ORA B", 1 },
+	{ "ORA C", 1 },
+	{ "ORA D", 1 },
+	{ "ORA E", 1 },
+	{ "ORA H", 1 },
+	{ "ORA L", 1 },
+	{ "ORA M", 1 },
+	{ "ORA A", 1 },
+	{ "CMP B", 1 },
+	{ "CMP C", 1 },
+	{ "CMP D", 1 },
+	{ "CMP E", 1 },
+	{ "CMP H", 1 },
+	{ "CMP L", 1 },
+	{ "CMP M", 1 },
+	{ "CMP A", 1 },
+	{ "RNZ", 1 },
+	{ "POP B", 1 },
+	{ "JNZ", 3 },
+	{ "JMP", 3 },
+	{ "CNZ", 3 },
+	{ "PUSH B", 1 },
+	{ "ADI", 2 },
+	{ "RST 0", 1 },
+	{ "RZ", 1 },
+	{ "RET", 1 },
+	{ "JZ", 3 },
+	{ "", 1 },
+	{ "CZ", 3 },
+	{ "CALL", 3 },
+	{ "ACI", 2 },
+	{ "RST1", 1 },
+	{ "RNC", 1 },
+	{ "POP D", 1 },
+	{ "JNC", 3 },
+	{ "OUT", 2 },
+	{ "CNC", 3 },
+	{ "PUSH D", 1 },
+	{ "SUI", 2 },
+	{ "RST 2", 1 },
+	{ "RC", 1 },
+	{ "", 1 },
+	{ "JC", 3 },
+	{ "IN D8", 2 },
+	{ "CC", 3 },
+	{ "", 1 },
+	{ "SBI", 2 },
+	{ "RST 3", 1 },
+	{ "RPO", 1 },
+	{ "POP H", 1 },
+	{ "JPO", 3 },
+	{ "XTHL", 1 },
+	{ "CPO", 3 },
+	{ "PUSH H", 1 },
+	{ "ANI", 2 },
+	{ "RST 4", 1 },
+	{ "RPE", 1 },
+	{ "PCHL", 1 },
+	{ "JPE", 3 },
+	{ "XCHG", 1 },
+	{ "CPE", 3 },
+	{ "", 1 },
+	{ "XRI", 2 },
+	{ "RST 5", 1 },
+	{ "RP", 1 },
+	{ "POP PSW", 1 },
+	{ "JP", 3 },
+	{ "DI", 1 },
+	{ "CP", 3 },
+	{ "PUSH PSW", 1 },
+	{ "ORI", 2 },
+	{ "RST 6", 1 },
+	{ "RM", 1 },
+	{ "SPHL", 1 },
+	{ "JM", 3 },
+	{ "EI", 1 },
+	{ "CM", 3 },
+	{ "", 1 },
+	{ "CPI", 2 },
+	{ "RST 7", 1 }
 	};
 
 	//from https://github.com/superzazu/8080
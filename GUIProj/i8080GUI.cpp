@@ -9,11 +9,22 @@
 #include "8080/ConsoleWindow.h"
 #include "8080/i8080Emulator.h"
 #include "8080/Display.h"
-#include "8080/Keyboard.h"
+#include "8080/EmulationThread.h"
+#include "8080/FramePacer.h"
+#include "8080/ScreenRenderer.h"
+
+namespace
+{
+    QRgb ToQRgb(uint16_t rgb444)
+    {
+        return qRgb(((rgb444 >> 8) & 0xF) * 17, ((rgb444 >> 4) & 0xF) * 17, (rgb444 & 0xF) * 17);
+    }
+}
 
 i8080GUI::i8080GUI(QWidget* parent)
     : QWidget(parent)
     , m_pI8080(new i8080Emulator())
+    , m_pEmulation(new EmulationThread(m_pI8080))
 	, m_ConsoleWindow(new ConsoleWindow())
 {
     // Connect button signal to appropriate slot
@@ -24,7 +35,16 @@ i8080GUI::i8080GUI(QWidget* parent)
     m_Width = m_pDisplay->GetWidth();
     m_Height = m_pDisplay->GetHeight();
     m_PixelSize = m_pDisplay->GetPixelSize();
-    m_pDisplay->AddDrawCallback([this] { repaint(); }); //will call qt's repaint when display is updated
+    //frames are published on the emulation thread, the paint is queued on the GUI thread
+    //update() only schedules a paint, several frames published before it happens are coalesced into one
+    m_pEmulation->SetFrameCallback([this] { QMetaObject::invokeMethod(this, [this] { update(); }, Qt::QueuedConnection); });
+    //the overlay colours are added in ComposeMono
+    m_pEmulation->Send(EmulationThread::Command::Type::SetPresentation, int64_t(Display::Presentation::Mono));
+    //only matters while fast-forwarding, real time never skips
+    m_pEmulation->Send(EmulationThread::Command::Type::SetFrameSkip, EmulationThread::frame_skip_auto);
+
+    m_Backing = QImage{ m_Width * m_PixelSize, m_Height * m_PixelSize, QImage::Format_RGB32 };
+    m_Backing.fill(ToQRgb(ScreenRenderer::black));
 
     ui.spinBox->setValue(m_pI8080->GetClockSpeed());
     ui.disassembleButton->setDisabled(true);
@@ -36,55 +56,171 @@ i8080GUI::i8080GUI(QWidget* parent)
 
 i8080GUI::~i8080GUI()
 {
+    delete m_pEmulation; //stops the thread before the emulator goes away
 	delete m_pI8080;
     delete m_ConsoleWindow;
 }
 
-void i8080GUI::Update8080()
+void i8080GUI::StartEmulation(int cpu, bool realtimePriority)
 {
-    m_pI8080->Update();
+    m_pEmulation->SetSchedulingOptions({ cpu, realtimePriority });
+    m_pEmulation->Start();
 }
 
-bool i8080GUI::GetIsClosed() const
+void i8080GUI::paintEvent(QPaintEvent*)
 {
-    return m_IsClosed;
+    //only convert when the emulation thread published a new frame, other repaints (expose, resize) reuse the backing image
+    const EmulationThread::Frame& frame = m_pEmulation->AcquireFrame();
+    if (frame.id != 0 && m_ComposedFrameId != frame.id)
+    {
+        ComposeFrame(frame.data.data(), frame.presentation == Display::Presentation::Mono);
+        m_ComposedFrameId = frame.id;
+    }
+
+    m_Painter.begin(this);
+    m_Painter.drawImage(0, m_MarginTop, m_Backing);
+    m_Painter.end();
 }
 
-void i8080GUI::paintEvent(QPaintEvent*)
+void i8080GUI::ComposeFrame(const uchar* data, bool mono)
+{
+    //no SmoothPixmapTransform, so scaling is nearest neighbour
+    QPainter painter(&m_Backing);
+
+    if (mono)
+        ComposeMono(painter, data);
+    else
+        ComposeRGB444(painter, data);
+}
+
+void i8080GUI::ComposeRGB444(QPainter& painter, const uchar* pixels)
 {
-    // Generate image from chip display data
-    //const auto& data = m_pI8080->GetDisplay()->GetPixels();;
-    const QImage image{ /*(uchar*)&data[0]*/ (uchar*)m_pDisplay->GetPixels(), m_Width, m_Height, QImage::Format_RGB444};
+    //wraps the frame's pixels without copying them
+    const QImage image{ pixels, m_Width, m_Height, QImage::Format_RGB444 };
 
-    //// Set image's colour palette to black and white
-    //image.setColorCount(2);
-    //image.setColorTable(QList<QRgb>{QColor("black").rgb(), QColor("white").rgb()});
+    painter.drawImage(m_Backing.rect(), image);
+}
 
-    // Create texture from image
-    const auto displayTexture = QPixmap::fromImage(image);
+void i8080GUI::ComposeMono(QPainter& painter, const uchar* plane)
+{
+    //wraps the frame's 1 bit plane without copying it
+    QImage image{ plane, m_Width, m_Height, m_pDisplay->GetMonoBytesPerLine(), QImage::Format_MonoLSB };
 
-    // Draw
-    m_Painter.begin(this);
-    m_Painter.setRenderHints(QPainter::Antialiasing); // No AA
+    //every overlay rectangle is drawn with a two colour palette of black and its own colour
+    for (const ScreenRenderer::OverlayRect& rect : m_pDisplay->GetRenderer()->GetOverlayRects())
+    {
+        image.setColorTable({ ToQRgb(ScreenRenderer::black), ToQRgb(rect.color) });
 
-    m_Painter.drawPixmap(0, m_MarginTop, m_Width * m_PixelSize, m_Height * m_PixelSize, displayTexture); // Draw virtual machine's display
+        const QRect source{ rect.x, rect.y, rect.width, rect.height };
+        const QRect target{ rect.x * m_PixelSize, rect.y * m_PixelSize, rect.width * m_PixelSize, rect.height * m_PixelSize };
+        painter.drawImage(target, image, source);
+    }
+}
 
-    m_Painter.end();
+void i8080GUI::changeEvent(QEvent* event)
+{
+    if (event->type() == QEvent::WindowStateChange)
+        UpdateOutputEnabled();
+
+    QWidget::changeEvent(event);
+}
+
+void i8080GUI::showEvent(QShowEvent* event)
+{
+    UpdateOutputEnabled();
+    QWidget::showEvent(event);
+}
+
+void i8080GUI::hideEvent(QHideEvent* event)
+{
+    UpdateOutputEnabled();
+    QWidget::hideEvent(event);
+}
+
+//frames nobody can see aren't converted at all
+void i8080GUI::UpdateOutputEnabled()
+{
+    m_pEmulation->Send(EmulationThread::Command::Type::SetOutputEnabled, isVisible() && !isMinimized());
 }
 
 void i8080GUI::keyPressEvent(QKeyEvent* key)
 {
-    m_pI8080->GetKeyboard()->KeyDown(key->key());
+    if (key->isAutoRepeat())
+        return;
+
+    //P pauses and resumes the emulation
+    if (key->key() == Qt::Key_P)
+    {
+        if (m_pEmulation->GetState() == EmulationThread::State::Paused)
+            m_pEmulation->Resume();
+        else
+            m_pEmulation->Pause();
+        return;
+    }
+
+    //F5 saves the state, F9 loads it again
+    if (key->key() == Qt::Key_F5)
+    {
+        m_pEmulation->Send(EmulationThread::Command::Type::SaveState, 0);
+        return;
+    }
+    if (key->key() == Qt::Key_F9)
+    {
+        m_pEmulation->LoadState(0);
+        return;
+    }
+
+    //F7 starts and stops recording a movie, F8 replays it
+    if (key->key() == Qt::Key_F7)
+    {
+        m_Recording = !m_Recording;
+        m_pEmulation->Send(EmulationThread::Command::Type::SetRecording, m_Recording);
+        return;
+    }
+    if (key->key() == Qt::Key_F8)
+    {
+        m_Recording = false;
+        m_pEmulation->PlayMovie();
+        return;
+    }
+
+    //F fast-forwards while it's held, Backspace rewinds
+    if (key->key() == Qt::Key_F)
+    {
+        m_pEmulation->Send(EmulationThread::Command::Type::SetSpeedMode, int64_t(FramePacer::Mode::Turbo));
+        return;
+    }
+    if (key->key() == Qt::Key_Backspace)
+    {
+        m_pEmulation->Send(EmulationThread::Command::Type::SetRewinding, true);
+        return;
+    }
+
+    m_pEmulation->Send(EmulationThread::Command::Type::KeyDown, key->key());
 }
 
 void i8080GUI::keyReleaseEvent(QKeyEvent* key)
 {
-    m_pI8080->GetKeyboard()->KeyUp(key->key());
+    if (key->isAutoRepeat())
+        return;
+
+    if (key->key() == Qt::Key_F)
+    {
+        m_pEmulation->Send(EmulationThread::Command::Type::SetSpeedMode, int64_t(FramePacer::Mode::RealTime));
+        return;
+    }
+    if (key->key() == Qt::Key_Backspace)
+    {
+        m_pEmulation->Send(EmulationThread::Command::Type::SetRewinding, false);
+        return;
+    }
+
+    m_pEmulation->Send(EmulationThread::Command::Type::KeyUp, key->key());
 }
 
 void i8080GUI::on_spinBox_valueChanged(int i)
 {
-    m_pI8080->SetClockSpeed(i);
+    m_pEmulation->Send(EmulationThread::Command::Type::SetClockSpeed, i);
 }
 
 void i8080GUI::on_inputButton_clicked(bool checked)
@@ -93,7 +229,7 @@ void i8080GUI::on_inputButton_clicked(bool checked)
         QString(),
         tr("Select ROM (*.rom; *.com; *.bin)"));
 
-    bool success = m_pI8080->LoadRom(m_ConsoleProgram, m_Input.toStdString().c_str());
+    bool success = m_pEmulation->LoadRom(m_ConsoleProgram, m_Input.toStdString().c_str());
 
     if (success)
     {
@@ -109,7 +245,11 @@ void i8080GUI::on_disassembleButton_clicked(bool checked)
     if (m_ConsoleProgram)
         m_ConsoleWindow->Restore(); //will show console window in case it was minimized
 
+    //the emulator can only be used directly while its thread is parked
+    const bool wasRunning = m_pEmulation->Pause();
     m_pI8080->PrintDisassembledRom();
+    if (wasRunning)
+        m_pEmulation->Resume();
 }
 
 void i8080GUI::on_checkBox_stateChanged(int state)
@@ -122,7 +262,6 @@ void i8080GUI::on_checkBox_stateChanged(int state)
 
 void i8080GUI::closeEvent(QCloseEvent* event)
 {
-    m_pI8080->Stop();
-    m_IsClosed = true;
+    m_pEmulation->Stop();
     event->accept();
 }
@@ -5,6 +5,7 @@
 
 class Display;
 class ConsoleWindow;
+class EmulationThread;
 class i8080Emulator;
 
 class i8080GUI : public QWidget
@@ -15,8 +16,8 @@ public:
     explicit i8080GUI(QWidget *parent = nullptr);
     ~i8080GUI() override;
 
-    void Update8080();
-    bool GetIsClosed() const;
+    //runs the emulator on its own thread until the window is closed
+    void StartEmulation(int cpu, bool realtimePriority);
 
 private slots:
     void paintEvent(QPaintEvent* pEvent);
@@ -28,15 +29,30 @@ private slots:
     void on_disassembleButton_clicked(bool checked);
     void on_checkBox_stateChanged(int state);
 
+private:
+    void changeEvent(QEvent* event) override;
+    void showEvent(QShowEvent* event) override;
+    void hideEvent(QHideEvent* event) override;
+    void UpdateOutputEnabled();
+
+    //converts a frame published by the emulation thread into m_Backing
+    void ComposeFrame(const uchar* data, bool mono);
+    void ComposeRGB444(QPainter& painter, const uchar* pixels);
+    void ComposeMono(QPainter& painter, const uchar* plane);
+
 private:
     Ui::i8080GUI ui{};
     QString m_Input{""};
     bool m_ConsoleProgram{false};
+    bool m_Recording{false}; //a movie, see F7
     i8080Emulator* m_pI8080;
+    EmulationThread* m_pEmulation;
     ConsoleWindow* m_ConsoleWindow;
-    bool m_IsClosed{false};
 
     QPainter m_Painter;
+    //the frame at window size with the overlay applied, repaints without a new frame just draw this
+    QImage m_Backing;
+    uint64_t m_ComposedFrameId{ UINT64_MAX };
     //No ownership
     Display* m_pDisplay{nullptr};
 
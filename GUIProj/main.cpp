@@ -1,36 +1,27 @@
-#include <chrono>
+#include <cstdlib>
+#include <cstring>
 #include "i8080GUI.h"
 
-using namespace std::chrono;
-
 int main(int argc, char *argv[])
 {
     QApplication app(argc, argv);
-    i8080GUI i8080GUI;
-    i8080GUI.show();
 
-    uint64_t lastUiUpdate{};
-    time_point<steady_clock> currTime{};
-    time_point<steady_clock> prevTime{};
-
-    while (!i8080GUI.GetIsClosed())
+    //optional scheduling of the emulation thread (Linux only)
+    //--emu-cpu N pins it to CPU N, --emu-realtime gives it SCHED_FIFO priority
+    int cpu = -1;
+    bool realtimePriority = false;
+    for (int i = 1; i < argc; ++i)
     {
-        currTime = steady_clock::now();
-        const auto deltaTime = std::chrono::duration_cast<microseconds>(currTime - prevTime).count();
-        prevTime = currTime;
-
-        lastUiUpdate += deltaTime;
-        if(lastUiUpdate >= 500)
-        {
-	        QApplication::processEvents(QEventLoop::EventLoopExec);
-            lastUiUpdate = 0;
-        }
-
-    	i8080GUI.Update8080();
+        if (std::strcmp(argv[i], "--emu-cpu") == 0 && i + 1 < argc)
+            cpu = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--emu-realtime") == 0)
+            realtimePriority = true;
     }
-    app.exit();
-    return 0;
-}
-
 
+    i8080GUI i8080GUI;
+    i8080GUI.show();
+    i8080GUI.StartEmulation(cpu, realtimePriority);
 
+    //the emulator runs on its own thread, this one only handles events and painting
+    return app.exec();
+}
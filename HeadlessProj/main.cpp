@@ -0,0 +1,604 @@
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <vector>
+#include "8080/Display.h"
+#include "8080/FramePacer.h"
+#include "8080/MachinePool.h"
+#include "8080/Movie.h"
+#include "8080/MovieVerifier.h"
+#include "8080/RewindBuffer.h"
+#include "8080/ScreenRenderer.h"
+#include "8080/StateWriter.h"
+#include "8080/i8080Emulator.h"
+
+using namespace std::chrono;
+
+namespace
+{
+    enum class RunLimit { Frames, Cycles, Instructions, UntilHalt };
+
+    void PrintUsage(const char* exe)
+    {
+        std::cerr << "Usage: " << exe << " <rom> [--console] [--frames N | --cycles N | --instructions N] [--speed N | --turbo] [--frame-skip N] [--load-state FILE] [--save-state FILE] [--rewind MIB [--keyframe-interval N]] [--record FILE [--movie-keyframes N] | --replay FILE [--seek FRAME] | --verify FILE [--threads N]] [--instances N [--threads N] [--quantum CYCLES]] [--no-idle-skip] [--bench-render N]\n"
+            << "  --console         load as a CP/M console program (starts at 0x100)\n"
+            << "  --frames N        run N emulated frames (default 600 for ROMs)\n"
+            << "  --cycles N        run N clock cycles\n"
+            << "  --instructions N  run N instructions\n"
+            << "  --speed N         run ROM frames paced at N times real time (1 = 2 MHz) and print the pacing stats\n"
+            << "  --turbo           run ROM frames through the pacer without waiting, skipping frames like the GUI does\n"
+            << "  --frame-skip N    only convert every N+1th frame to pixels\n"
+            << "  --load-state FILE start from a save state of the same ROM\n"
+            << "  --save-state FILE save the state after the run\n"
+            << "  --rewind MIB      capture a rewind snapshot every frame into a MIB sized ring and print the capture cost\n"
+            << "  --keyframe-interval N  frames in between rewind keyframes (default 60)\n"
+            << "  --record FILE     record the run as an input movie\n"
+            << "  --movie-keyframes N  frames in between the movie's keyframes (default 600, 0 for none)\n"
+            << "  --replay FILE     replay an input movie (all of it by default) and check every frame against it\n"
+            << "  --seek FRAME      start the replay at FRAME, from the keyframe before it\n"
+            << "  --verify FILE     check a whole movie, replaying the parts in between keyframes in parallel\n"
+            << "  --threads N       threads for --verify and --instances (default all)\n"
+            << "  --instances N     run N copies of the ROM at once and print their throughput\n"
+            << "  --quantum CYCLES  cycles an instance runs before the thread picks the next one (default 133332)\n"
+            << "  --no-idle-skip    interpret wait loops instead of skipping to the next interrupt\n"
+            << "  --bench-render N  after the run, convert the final VRAM N times with every renderer\n"
+            << "Console programs run until they exit when no limit is given.\n";
+    }
+
+    //captures a rewind snapshot whenever a frame ended and times it
+    struct RewindBenchmark
+    {
+        RewindBenchmark(uint32_t budgetMiB, uint32_t keyframeInterval)
+            : buffer(budgetMiB, keyframeInterval)
+        {
+        }
+
+        void OnBatchEnd(const i8080Emulator& i8080)
+        {
+            if (i8080.GetFrameCount() == lastFrame)
+                return;
+            lastFrame = i8080.GetFrameCount();
+
+            const auto start = steady_clock::now();
+            buffer.Capture(i8080);
+            captureTimes.push_back(steady_clock::now() - start);
+        }
+
+        //the frames are replayed the way the limit ran them, --instructions doesn't skip wait loops
+        void Print(i8080Emulator& i8080, RunLimit limit)
+        {
+            const RewindBuffer::Stats& stats = buffer.GetStats();
+            if (stats.captures == 0)
+            {
+                std::cout << "rewind:       no snapshots, the run ended before the first frame\n";
+                return;
+            }
+
+            //the max is mostly the host preempting the thread, the 99th percentile is what a frame usually costs
+            std::sort(captureTimes.begin(), captureTimes.end());
+            nanoseconds totalTime{};
+            for (const nanoseconds time : captureTimes)
+                totalTime += time;
+
+            constexpr double frame_us = 1e6 / FramePacer::presentation_rate;
+            const double meanUs = duration<double, std::micro>(totalTime).count() / captureTimes.size();
+            const double p99Us = duration<double, std::micro>(captureTimes[captureTimes.size() * 99 / 100]).count();
+            const double maxUs = duration<double, std::micro>(captureTimes.back()).count();
+
+            std::cout << "rewind:       " << buffer.GetSnapshotCount() << " snapshots back to frame " << buffer.GetOldestFrame()
+                << ", " << buffer.GetUsedBytes() / 1024.0 << " of " << buffer.GetBudgetBytes() / 1024.0 << " KiB, "
+                << stats.keyframes << " keyframes (every " << buffer.GetKeyframeInterval() << ")\n"
+                << "capture:      " << meanUs << " us mean, " << p99Us << " us 99th percentile, " << maxUs << " us max ("
+                << 100.0 * meanUs / frame_us << "% / " << 100.0 * p99Us / frame_us << "% of a 60 fps frame)\n"
+                << "              "
+                << double(stats.storedBytes) / stats.captures << " bytes/snapshot ("
+                << double(stats.stateBytes) / stats.storedBytes << ":1)\n";
+
+            //rewinding and running the same frames again has to end up in the same state
+            //a run can end in the middle of a frame (--cycles), so it's compared to the newest snapshot
+            std::vector<uint8_t> expected, replayed;
+            if (!buffer.Rewind(i8080, 0))
+                return;
+            i8080.SaveState(expected);
+            const uint64_t frame = i8080.GetFrameCount();
+            const uint32_t frames = uint32_t(std::min<uint64_t>(buffer.GetSnapshotCount() - 1, buffer.GetKeyframeInterval() * 3 / 2 + 1));
+
+            const auto start = steady_clock::now();
+            const bool rewound = buffer.Rewind(i8080, frames);
+            const double rewindUs = duration<double, std::micro>(steady_clock::now() - start).count();
+
+            while (rewound && i8080.GetFrameCount() < frame && !i8080.IsHalted())
+            {
+                if (limit == RunLimit::Instructions)
+                    i8080.RunInstructions(UINT64_MAX, true);
+                else
+                    i8080.RunFrame();
+            }
+            i8080.SaveState(replayed);
+
+            std::cout << "rewind check: " << frames << " frames back in " << rewindUs << " us, replayed "
+                << (rewound && replayed == expected ? "ok" : "MISMATCH") << '\n';
+        }
+
+        RewindBuffer buffer;
+        uint64_t lastFrame{};
+        std::vector<nanoseconds> captureTimes;
+    };
+
+    //storage pages the instances don't share with another one (written to, or loaded)
+    size_t CountPrivatePages(const MachinePool& pool)
+    {
+        size_t pages = 0;
+        for (size_t i = 0; i < pool.GetMachineCount(); ++i)
+            pages += Memory::page_count - std::popcount(pool.GetMachine(i)->GetMemory().GetSharedStoragePages());
+        return pages;
+    }
+
+    //runs copies of the ROM on a MachinePool, false if one couldn't be set up
+    bool RunInstances(const char* romPath, bool consoleProgram, bool idleSkipping, const char* loadStatePath,
+        MachinePool::Limit limit, size_t instances, unsigned threads, uint64_t quantumCycles)
+    {
+        std::vector<uint8_t> state;
+        if (loadStatePath != nullptr && !StateWriter::Read(loadStatePath, state))
+            return false;
+
+        MachinePool pool(threads, quantumCycles);
+        if (!pool.Add(romPath, consoleProgram, limit))
+            return false;
+
+        i8080Emulator* first = pool.GetMachine(0);
+        first->SetIdleSkipping(idleSkipping);
+        if (!state.empty() && !first->LoadState(state))
+            return false;
+
+        //the others are clones, they share the ROM and every page until they write to it
+        const auto cloneStart = steady_clock::now();
+        for (size_t i = 1; i < instances; ++i)
+            pool.Add(first->Clone(), limit);
+        const double cloneSeconds = duration<double>(steady_clock::now() - cloneStart).count();
+
+        pool.Run();
+
+        const MachinePool::Stats& stats = pool.GetStats();
+        std::cout << '\n' << std::fixed << std::setprecision(2);
+
+        //a line per instance is only readable for a few of them
+        if (instances <= 16)
+        {
+            for (size_t i = 0; i < instances; ++i)
+            {
+                const MachinePool::MachineStats& machine = pool.GetMachineStats(i);
+                std::cout << "instance " << std::setw(2) << i << ":  " << machine.instructions << " instructions, "
+                    << machine.frames << " frames, " << machine.instructions / machine.seconds / 1e6 << " M/s, "
+                    << machine.quanta << " quanta, " << machine.migrations << " migrations"
+                    << (machine.halted ? ", halted" : "") << '\n';
+            }
+        }
+
+        double minSeconds = stats.workerSeconds.front();
+        double maxSeconds = stats.workerSeconds.front();
+        for (const double seconds : stats.workerSeconds)
+        {
+            minSeconds = std::min(minSeconds, seconds);
+            maxSeconds = std::max(maxSeconds, seconds);
+        }
+
+        std::cout << "\ninstances:    " << instances << " on " << stats.threads << " threads, "
+            << stats.quanta << " quanta, " << stats.steals << " steals\n"
+            << "instructions: " << stats.instructions << " (" << stats.instructions / stats.seconds / 1e6 << " M/s)\n"
+            << "cycles:       " << stats.cycles << " (" << stats.cycles / stats.seconds / 1e6 << " MHz effective)\n"
+            << "frames:       " << stats.frames << " (" << stats.frames / stats.seconds << " fps)\n"
+            << "workers busy: " << minSeconds * 1e3 << " - " << maxSeconds * 1e3 << " ms\n"
+            << "clones:       " << instances - 1 << " in " << cloneSeconds * 1e3 << " ms ("
+            << (instances > 1 ? cloneSeconds / double(instances - 1) * 1e6 : 0.0) << " us each), "
+            << CountPrivatePages(pool) << " of " << instances * Memory::page_count << " pages copied\n"
+            << "elapsed:      " << stats.seconds * 1e3 << " ms\n";
+
+        return true;
+    }
+
+    //full redraws of the same VRAM with every render path, checked against the reference loop
+    void BenchmarkRenderers(const uint8_t* VRAM, uint16_t width, uint16_t height, uint64_t iterations)
+    {
+        ScreenRenderer renderer(width, height);
+        std::vector<uint16_t> reference(width * height);
+        std::vector<uint16_t> pixels(width * height);
+
+        renderer.SetPath(ScreenRenderer::Path::Reference);
+        renderer.RenderAll(VRAM, reference.data());
+
+        double referenceTime{};
+
+        std::cout << "\nrender benchmark (" << iterations << " full frames)\n";
+        for (const ScreenRenderer::Path path : { ScreenRenderer::Path::Reference, ScreenRenderer::Path::Scalar,
+            ScreenRenderer::Path::SSE2, ScreenRenderer::Path::AVX2 })
+        {
+            if (!ScreenRenderer::IsSupported(path))
+                continue;
+
+            renderer.SetPath(path);
+            std::fill(pixels.begin(), pixels.end(), 0);
+
+            const auto start = steady_clock::now();
+            for (uint64_t i = 0; i < iterations; ++i)
+                renderer.RenderAll(VRAM, pixels.data());
+            const double seconds = duration<double>(steady_clock::now() - start).count();
+
+            if (path == ScreenRenderer::Path::Reference)
+                referenceTime = seconds;
+
+            const bool matches = pixels == reference;
+            std::cout << "  " << std::setw(10) << std::left << ScreenRenderer::GetPathName(path) << std::right
+                << std::setw(8) << seconds / iterations * 1e6 << " us/frame  "
+                << std::setw(6) << referenceTime / seconds << "x  "
+                << (matches ? "ok" : "MISMATCH") << '\n';
+        }
+
+        //1 bit plane only, the pixels that are lit have to match the reference
+        const uint16_t bytesPerLine = renderer.GetMonoBytesPerLine();
+        std::vector<uint8_t> plane(bytesPerLine * height);
+        renderer.SetPath(ScreenRenderer::GetBestSupportedPath());
+
+        const auto start = steady_clock::now();
+        for (uint64_t i = 0; i < iterations; ++i)
+            renderer.RenderMono(VRAM, plane.data(), ~0u);
+        const double seconds = duration<double>(steady_clock::now() - start).count();
+
+        bool matches = true;
+        for (uint32_t y = 0; y < height; ++y)
+            for (uint32_t x = 0; x < width; ++x)
+                matches &= (((plane[y * bytesPerLine + x / 8] >> (x % 8)) & 1) != 0) == (reference[y * width + x] != ScreenRenderer::black);
+
+        std::cout << "  " << std::setw(10) << std::left << "mono" << std::right
+            << std::setw(8) << seconds / iterations * 1e6 << " us/frame  "
+            << std::setw(6) << referenceTime / seconds << "x  "
+            << (matches ? "ok" : "MISMATCH") << '\n';
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const char* romPath{ nullptr };
+    bool consoleProgram{ false };
+    bool idleSkipping{ true };
+    uint64_t renderIterations{};
+    uint32_t speed{}; //0 runs unthrottled
+    bool turbo{ false };
+    uint32_t frameSkip{};
+    const char* loadStatePath{ nullptr };
+    const char* saveStatePath{ nullptr };
+    uint32_t rewindMiB{};
+    uint32_t keyframeInterval{ RewindBuffer::default_keyframe_interval };
+    const char* recordPath{ nullptr };
+    const char* replayPath{ nullptr };
+    const char* verifyPath{ nullptr };
+    uint32_t movieKeyframes{ Movie::default_keyframe_interval };
+    uint64_t seekFrame{};
+    unsigned threads{};
+    size_t instances{};
+    uint64_t quantumCycles{ MachinePool::default_quantum_cycles };
+    RunLimit limit{ RunLimit::UntilHalt };
+    uint64_t limitValue{};
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const char* arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+
+        if (std::strcmp(arg, "--console") == 0)
+            consoleProgram = true;
+        else if (std::strcmp(arg, "--no-idle-skip") == 0)
+            idleSkipping = false;
+        else if (std::strcmp(arg, "--speed") == 0 && hasValue)
+            speed = uint32_t(std::strtoul(argv[++i], nullptr, 10));
+        else if (std::strcmp(arg, "--turbo") == 0)
+            turbo = true;
+        else if (std::strcmp(arg, "--frame-skip") == 0 && hasValue)
+            frameSkip = uint32_t(std::strtoul(argv[++i], nullptr, 10));
+        else if (std::strcmp(arg, "--load-state") == 0 && hasValue)
+            loadStatePath = argv[++i];
+        else if (std::strcmp(arg, "--save-state") == 0 && hasValue)
+            saveStatePath = argv[++i];
+        else if (std::strcmp(arg, "--rewind") == 0 && hasValue)
+            rewindMiB = uint32_t(std::strtoul(argv[++i], nullptr, 10));
+        else if (std::strcmp(arg, "--keyframe-interval") == 0 && hasValue)
+            keyframeInterval = uint32_t(std::strtoul(argv[++i], nullptr, 10));
+        else if (std::strcmp(arg, "--record") == 0 && hasValue)
+            recordPath = argv[++i];
+        else if (std::strcmp(arg, "--replay") == 0 && hasValue)
+            replayPath = argv[++i];
+        else if (std::strcmp(arg, "--movie-keyframes") == 0 && hasValue)
+            movieKeyframes = uint32_t(std::strtoul(argv[++i], nullptr, 10));
+        else if (std::strcmp(arg, "--seek") == 0 && hasValue)
+            seekFrame = std::strtoull(argv[++i], nullptr, 10);
+        else if (std::strcmp(arg, "--verify") == 0 && hasValue)
+            verifyPath = argv[++i];
+        else if (std::strcmp(arg, "--threads") == 0 && hasValue)
+            threads = unsigned(std::strtoul(argv[++i], nullptr, 10));
+        else if (std::strcmp(arg, "--instances") == 0 && hasValue)
+            instances = std::strtoull(argv[++i], nullptr, 10);
+        else if (std::strcmp(arg, "--quantum") == 0 && hasValue)
+            quantumCycles = std::strtoull(argv[++i], nullptr, 10);
+        else if (std::strcmp(arg, "--bench-render") == 0 && hasValue)
+            renderIterations = std::strtoull(argv[++i], nullptr, 10);
+        else if (std::strcmp(arg, "--frames") == 0 && hasValue)
+            limit = RunLimit::Frames, limitValue = std::strtoull(argv[++i], nullptr, 10);
+        else if (std::strcmp(arg, "--cycles") == 0 && hasValue)
+            limit = RunLimit::Cycles, limitValue = std::strtoull(argv[++i], nullptr, 10);
+        else if (std::strcmp(arg, "--instructions") == 0 && hasValue)
+            limit = RunLimit::Instructions, limitValue = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg[0] != '-' && romPath == nullptr)
+            romPath = arg;
+        else
+        {
+            PrintUsage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (romPath == nullptr)
+    {
+        PrintUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    //--verify runs its own machines and returns before the rest is used
+    if ((recordPath != nullptr && replayPath != nullptr)
+        || (verifyPath != nullptr && (recordPath != nullptr || replayPath != nullptr || rewindMiB > 0 || loadStatePath != nullptr || saveStatePath != nullptr || instances > 0)))
+    {
+        PrintUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    Movie movie{};
+    if (replayPath != nullptr || verifyPath != nullptr)
+    {
+        std::vector<uint8_t> data;
+        if (!StateWriter::Read(replayPath != nullptr ? replayPath : verifyPath, data) || !movie.Read(data))
+            return EXIT_FAILURE;
+
+        //the rest of the movie unless told otherwise
+        if (limit == RunLimit::UntilHalt)
+        {
+            limit = RunLimit::Frames;
+            limitValue = movie.frameHashes.size() - std::min<uint64_t>(seekFrame, movie.frameHashes.size());
+        }
+    }
+
+    if (verifyPath != nullptr)
+    {
+        MovieVerifier verifier(romPath, consoleProgram, threads);
+        MovieVerifier::Result result;
+
+        const auto start = steady_clock::now();
+        if (!verifier.Verify(movie, result))
+            return EXIT_FAILURE;
+        const double seconds = duration<double>(steady_clock::now() - start).count();
+
+        std::cout << std::fixed << std::setprecision(2)
+            << "verify:       " << result.framesChecked << " frames in " << result.segments << " segments on "
+            << result.threads << " threads, " << seconds * 1e3 << " ms (" << result.framesChecked / seconds << " fps)\n"
+            << "              ";
+        if (result.inSync)
+            std::cout << "in sync\n";
+        else
+            std::cout << "DESYNC at frame " << result.desyncFrame << '\n';
+
+        return result.inSync ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    //roms never halt by themselves so give them a default frame count
+    if (limit == RunLimit::UntilHalt && !consoleProgram)
+    {
+        limit = RunLimit::Frames;
+        limitValue = 600;
+    }
+
+    if (instances > 0)
+    {
+        //the pool runs whole quanta, there's no instruction limit
+        //the machines run unthrottled with their output disabled, none of the single machine options apply (but --load-state)
+        if (limit == RunLimit::Instructions || recordPath != nullptr || replayPath != nullptr || rewindMiB > 0 || speed > 0 || turbo
+            || frameSkip > 0 || saveStatePath != nullptr || renderIterations > 0)
+        {
+            PrintUsage(argv[0]);
+            return EXIT_FAILURE;
+        }
+
+        MachinePool::Limit poolLimit{};
+        if (limit == RunLimit::Frames)
+            poolLimit.frames = limitValue;
+        else if (limit == RunLimit::Cycles)
+            poolLimit.cycles = limitValue;
+
+        return RunInstances(romPath, consoleProgram, idleSkipping, loadStatePath, poolLimit, instances, threads, quantumCycles)
+            ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    i8080Emulator i8080{};
+    i8080.SetIdleSkipping(idleSkipping);
+    if (!i8080.LoadRom(consoleProgram, romPath))
+        return EXIT_FAILURE;
+
+    if (loadStatePath != nullptr)
+    {
+        std::vector<uint8_t> state;
+        if (!StateWriter::Read(loadStatePath, state) || !i8080.LoadState(state))
+            return EXIT_FAILURE;
+    }
+
+    Display* display = i8080.GetDisplay();
+    display->SetFrameSkip(frameSkip);
+
+    FramePacer* pacer = i8080.GetPacer();
+    if (turbo)
+        pacer->SetMode(FramePacer::Mode::Turbo);
+    else if (speed > 0)
+    {
+        pacer->SetMode(speed == 1 ? FramePacer::Mode::RealTime : FramePacer::Mode::Multiplier);
+        pacer->SetMultiplier(speed);
+    }
+    const bool paced = turbo || speed > 0;
+
+    std::optional<RewindBenchmark> rewind;
+    if (rewindMiB > 0)
+        rewind.emplace(rewindMiB, keyframeInterval);
+
+    //starting a movie loads its start state, so it comes after --load-state
+    MovieRecorder recorder(&i8080);
+    MoviePlayer player(&i8080);
+    if (recordPath != nullptr)
+        recorder.Start(movieKeyframes);
+    if (replayPath != nullptr)
+    {
+        if (!player.Start(&movie))
+            return EXIT_FAILURE;
+
+        if (seekFrame > 0)
+        {
+            const auto seekStart = steady_clock::now();
+            if (!player.Seek(seekFrame))
+            {
+                std::cerr << "Couldn't seek to frame " << seekFrame << '\n';
+                return EXIT_FAILURE;
+            }
+            std::cout << "seek:         frame " << seekFrame << " in "
+                << duration<double, std::milli>(steady_clock::now() - seekStart).count() << " ms\n";
+        }
+    }
+
+    const auto onBatchEnd = [&]
+    {
+        if (rewind)
+            rewind->OnBatchEnd(i8080);
+        recorder.OnBatchEnd();
+        player.OnBatchEnd();
+    };
+
+    const auto start = steady_clock::now();
+
+    switch (limit)
+    {
+    case RunLimit::Frames:
+        //Update() waits for the pacer in between events, RunFrame doesn't
+        if (paced)
+        {
+            const uint64_t endFrame = i8080.GetFrameCount() + limitValue;
+            while (i8080.GetFrameCount() < endFrame && !i8080.IsHalted())
+            {
+                i8080.Update();
+                if (turbo)
+                    display->SetFrameSkip(pacer->GetSuggestedFrameSkip());
+                onBatchEnd();
+            }
+        }
+        else
+        {
+            for (uint64_t frame = 0; frame < limitValue && !i8080.IsHalted(); ++frame)
+            {
+                i8080.RunFrame();
+                onBatchEnd();
+            }
+        }
+        break;
+    //the other limits stop at every frame as well, so the rewind, recorder and player see the same frames
+    case RunLimit::Cycles:
+        for (const uint64_t end = i8080.GetClockCount() + limitValue; i8080.GetClockCount() < end && !i8080.IsHalted(); )
+        {
+            i8080.RunCycles(end - i8080.GetClockCount(), true);
+            onBatchEnd();
+        }
+        break;
+    case RunLimit::Instructions:
+        for (const uint64_t end = i8080.GetInstructionCount() + limitValue; i8080.GetInstructionCount() < end && !i8080.IsHalted(); )
+        {
+            i8080.RunInstructions(end - i8080.GetInstructionCount(), true);
+            onBatchEnd();
+        }
+        break;
+    case RunLimit::UntilHalt:
+        while (!i8080.IsHalted())
+        {
+            i8080.RunFrame();
+            onBatchEnd();
+        }
+        break;
+    }
+
+    const double seconds = duration<double>(steady_clock::now() - start).count();
+    const uint64_t instructions = i8080.GetInstructionCount();
+    const uint64_t cycles = i8080.GetClockCount();
+    const uint64_t frames = i8080.GetFrameCount();
+    const uint64_t skipped = i8080.GetSkippedCycles();
+    const uint64_t dirtyBytes = display->GetTotalDirtyByteCount();
+    const uint64_t skippedFrames = display->GetSkippedFrameCount();
+
+    std::cout << '\n' << std::fixed << std::setprecision(2)
+        << "instructions: " << instructions << " (" << instructions / seconds / 1e6 << " M/s)\n"
+        << "cycles:       " << cycles << " (" << cycles / seconds / 1e6 << " MHz effective)\n"
+        << "skipped:      " << skipped << " cycles (" << (cycles ? 100.0 * skipped / cycles : 0.0) << "% idle)\n"
+        << "frames:       " << frames << " (" << frames / seconds << " fps)\n"
+        << "vram dirty:   " << (frames ? dirtyBytes / double(frames) : 0.0) << " bytes/frame\n"
+        << "frame skip:   " << skippedFrames << " frames not converted\n"
+        << "elapsed:      " << seconds * 1e3 << " ms\n";
+
+    if (paced && !consoleProgram)
+    {
+        const FramePacer::Stats& stats = pacer->GetStats();
+        std::cout << "pacing:       " << stats.GetFps() << " fps, frame time "
+            << duration<double, std::milli>(stats.minFrameTime).count() << " - "
+            << duration<double, std::milli>(stats.maxFrameTime).count() << " ms\n"
+            << "jitter:       " << duration<double, std::micro>(stats.MeanJitter()).count() << " us mean, "
+            << duration<double, std::micro>(stats.maxJitter).count() << " us max over " << stats.waits << " waits\n"
+            << "drift:        " << duration<double, std::milli>(stats.drift).count() << " ms ("
+            << stats.lateWaits << " late, " << stats.resyncs << " resyncs)\n";
+    }
+
+    if (recorder.IsRecording())
+    {
+        recorder.Stop();
+        std::vector<uint8_t> data;
+        recorder.GetMovie().Write(data);
+        std::cout << "recorded:     " << recorder.GetMovie().frameHashes.size() << " frames, "
+            << recorder.GetMovie().inputs.size() << " input changes, " << data.size() << " bytes\n";
+
+        StateWriter writer; //the destructor waits for the write
+        writer.Write(recordPath, std::move(data));
+    }
+
+    if (player.IsPlaying())
+    {
+        std::cout << "replay:       " << player.GetFramesChecked() << " of " << player.GetFrameCount() << " frames, ";
+        if (player.GetDesyncFrame() >= 0)
+            std::cout << "DESYNC at frame " << player.GetDesyncFrame() << '\n';
+        else
+            std::cout << "in sync\n";
+        player.Stop();
+    }
+
+    if (saveStatePath != nullptr)
+    {
+        std::vector<uint8_t> state;
+        i8080.SaveState(state);
+        StateWriter writer; //the destructor waits for the write
+        writer.Write(saveStatePath, std::move(state));
+    }
+
+    if (renderIterations > 0)
+    {
+        BenchmarkRenderers(i8080.GetVRAM(), display->GetWidth(), display->GetHeight(), renderIterations);
+    }
+
+    //last, the check rewinds and replays the machine to the newest snapshot
+    if (rewind)
+    {
+        rewind->Print(i8080, limit);
+    }
+
+    return player.GetDesyncFrame() >= 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}